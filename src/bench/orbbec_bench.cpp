@@ -0,0 +1,299 @@
+// Microbenchmarks of the per-frame kernels: color, depth and IR conversion, texture staging and PLY export.
+// Inputs are synthetic frames in the device wire formats, see SyntheticFrameSource::buildFrame().
+//
+// orbbec_sample_bench [--filter TEXT] [--min-time MS] [--threads N]
+//                     [--save FILE] [--baseline FILE [--threshold PCT]]
+#include "frame_convert.h"
+#include "synthetic_source.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <functional>
+#include <algorithm>
+
+typedef struct Bench_S {
+    std::string name;
+    uint64_t pixels = 0;                // work items of one run: pixels, or points for the PLY export
+    uint64_t inputBytes = 0;
+    std::function<void()> run;
+} Bench_S;
+
+typedef struct BenchResult_S {
+    std::string name;
+    uint64_t pixels = 0;
+    int iterations = 0;
+    double nsPerPixel = 0.0;            // median run
+    double mpixPerSec = 0.0;
+    double mbPerSec = 0.0;              // input bytes
+} BenchResult_S;
+
+static void printUsage()
+{
+    printf("Usage: orbbec_sample_bench [options]\n");
+    printf("  --filter TEXT      only run benchmarks whose name contains TEXT\n");
+    printf("  --min-time MS      time spent measuring each benchmark (default 500)\n");
+    printf("  --threads N        OpenCV worker threads, 0 keeps the OpenCV default\n");
+    printf("  --save FILE        write the results as a JSON baseline\n");
+    printf("  --baseline FILE    compare against a baseline, exits with 1 on regressions\n");
+    printf("  --threshold PCT    slowdown in ns/pixel reported as regression (default 10)\n");
+}
+
+static std::string sizeName(int width, int height)
+{
+    return std::to_string(width) + "x" + std::to_string(height);
+}
+
+// A frame slot holding one synthetic frame, as Sensors would publish it
+static FrameSlot_S makeFrame(StreamIndex stream, OBFormat format, int width, int height)
+{
+    static const OBFrameType frameTypes[STREAM_COUNT] = { OB_FRAME_COLOR, OB_FRAME_DEPTH, OB_FRAME_IR };
+    SyntheticStreamConfig_S config;
+    config.width = width;
+    config.height = height;
+    config.format = format;
+    config.noise = 4;
+    std::shared_ptr<std::vector<uint8_t>> buffer = SyntheticFrameSource::buildFrame(stream, config, 0.5f, 1);
+
+    FrameSlot_S frame;
+    frame.holder = buffer;
+    frame.data = buffer->data();
+    frame.dataSize = (uint32_t)buffer->size();
+    frame.width = width;
+    frame.height = height;
+    frame.type = frameTypes[stream];
+    frame.format = format;
+    frame.pixelBitSize = format == OB_FORMAT_Y16 ? (stream == STREAM_DEPTH ? 16 : 10) : 8;
+    return frame;
+}
+
+// The kernel runs on one slot over and over, like a convert worker reusing its output images
+static Bench_S makeConvertBench(const std::string& name, StreamIndex stream, OBFormat format, int width, int height,
+    std::function<void(ImageSlot_S&)> convert)
+{
+    std::shared_ptr<ImageSlot_S> slot = std::make_shared<ImageSlot_S>();
+    slot->frame = makeFrame(stream, format, width, height);
+
+    Bench_S bench;
+    bench.name = name + "_" + sizeName(width, height);
+    bench.pixels = (uint64_t)width * height;
+    bench.inputBytes = slot->frame.dataSize;
+    bench.run = [slot, convert]() { convert(*slot); };
+    return bench;
+}
+
+static std::vector<Bench_S> makeBenchmarks()
+{
+    static const int colorSizes[][2] = { { 640, 480 }, { 1280, 720 }, { 1920, 1080 } };
+    static const int depthSizes[][2] = { { 640, 480 }, { 1280, 800 } };
+    static const OBFormat colorFormats[] = { OB_FORMAT_MJPG, OB_FORMAT_NV21, OB_FORMAT_NV12, OB_FORMAT_I420, OB_FORMAT_YUYV, OB_FORMAT_UYVY, OB_FORMAT_RGB888 };
+    static const OBFormat irFormats[] = { OB_FORMAT_Y16, OB_FORMAT_Y8, OB_FORMAT_MJPG };
+    static DepthColorParam_S colorParam;
+    std::vector<Bench_S> benchmarks;
+
+    for (OBFormat format : colorFormats) {
+        for (const int* size : colorSizes) {
+            benchmarks.push_back(makeConvertBench("color_" + OBFormatToString(format), STREAM_COLOR, format, size[0], size[1],
+                [](ImageSlot_S& slot) { convertColorFrame(slot); }));
+        }
+    }
+    // Preview decoding; ns/pixel still counts the full frame
+    for (int reduction = 2; reduction <= 8; reduction *= 2) {
+        benchmarks.push_back(makeConvertBench("color_MJPG_reduced" + std::to_string(reduction), STREAM_COLOR, OB_FORMAT_MJPG, 1920, 1080,
+            [reduction](ImageSlot_S& slot) { convertColorFrame(slot, reduction); }));
+    }
+    for (const int* size : depthSizes) {
+        benchmarks.push_back(makeConvertBench("depth_Y16", STREAM_DEPTH, OB_FORMAT_Y16, size[0], size[1],
+            [](ImageSlot_S& slot) { convertDepthFrame(slot, colorParam); }));
+        benchmarks.push_back(makeConvertBench("depth_Y16_gaussian5", STREAM_DEPTH, OB_FORMAT_Y16, size[0], size[1],
+            [](ImageSlot_S& slot) {
+                convertDepthFrame(slot, colorParam);
+                applyDepthFilter(slot.image, DEPTH_FILTER_GAUSSIAN, 5);
+            }));
+    }
+    for (OBFormat format : irFormats) {
+        for (const int* size : depthSizes) {
+            benchmarks.push_back(makeConvertBench("ir_" + OBFormatToString(format), STREAM_IR, format, size[0], size[1],
+                [](ImageSlot_S& slot) { convertIRFrame(slot); }));
+        }
+    }
+
+    // CPU side of StreamTexture::update(); the upload itself needs a GL context
+    for (const int* size : depthSizes) {
+        std::shared_ptr<cv::Mat> gray = std::make_shared<cv::Mat>(size[1], size[0], CV_8UC1);
+        gray->setTo(cv::Scalar(128));
+        std::shared_ptr<cv::Mat> target = std::make_shared<cv::Mat>();
+        Bench_S bench;
+        bench.name = "texture_gray_" + sizeName(size[0], size[1]);
+        bench.pixels = (uint64_t)size[0] * size[1];
+        bench.inputBytes = bench.pixels;
+        bench.run = [gray, target]() { convertTextureImage(*gray, *target); };
+        benchmarks.push_back(bench);
+    }
+
+    // One point per depth pixel
+    {
+        std::shared_ptr<std::vector<OBColorPoint>> points = std::make_shared<std::vector<OBColorPoint>>(640 * 480);
+        for (size_t i = 0; i < points->size(); i++) {
+            OBColorPoint& point = (*points)[i];
+            point.x = (float)(i % 640) - 320.0f;
+            point.y = (float)(i / 640) - 240.0f;
+            point.z = 500.0f + (float)(i % 4000);
+            point.r = (float)(i & 255);
+            point.g = (float)((i >> 8) & 255);
+            point.b = 128.0f;
+        }
+        Bench_S bench;
+        bench.name = "ply_export_640x480";
+        bench.pixels = points->size();
+        bench.inputBytes = points->size() * sizeof(OBColorPoint);
+        bench.run = [points]() { savePointsToPly(points->data(), points->size(), "bench_points.ply"); };
+        benchmarks.push_back(bench);
+    }
+    return benchmarks;
+}
+
+static BenchResult_S runBenchmark(const Bench_S& bench, double minTimeMs)
+{
+    typedef std::chrono::steady_clock Clock;
+    // Warm up caches, thread pools and the output allocations
+    bench.run();
+    bench.run();
+
+    std::vector<double> runNs;
+    Clock::time_point begin = Clock::now();
+    while (runNs.size() < 5 || std::chrono::duration<double, std::milli>(Clock::now() - begin).count() < minTimeMs) {
+        Clock::time_point start = Clock::now();
+        bench.run();
+        runNs.push_back(std::chrono::duration<double, std::nano>(Clock::now() - start).count());
+    }
+    std::sort(runNs.begin(), runNs.end());
+    double medianNs = runNs[runNs.size() / 2];
+
+    BenchResult_S result;
+    result.name = bench.name;
+    result.pixels = bench.pixels;
+    result.iterations = (int)runNs.size();
+    result.nsPerPixel = medianNs / (double)bench.pixels;
+    result.mpixPerSec = (double)bench.pixels / medianNs * 1000.0;
+    result.mbPerSec = (double)bench.inputBytes / medianNs * 1000.0;
+    return result;
+}
+
+// One benchmark per line, so the baseline reads back without a JSON parser
+static bool saveResults(const std::vector<BenchResult_S>& results, const std::string& fileName)
+{
+    std::ofstream file(fileName);
+    if (!file.is_open()) return false;
+    file << "{ \"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchResult_S& r = results[i];
+        file << "  { \"name\": \"" << r.name << "\", \"pixels\": " << r.pixels << ", \"iterations\": " << r.iterations
+            << ", \"nsPerPixel\": " << r.nsPerPixel << ", \"mpixPerSec\": " << r.mpixPerSec << ", \"mbPerSec\": " << r.mbPerSec
+            << " }" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    file << "] }\n";
+    return true;
+}
+
+static bool loadBaseline(const std::string& fileName, std::map<std::string, double>& nsPerPixel)
+{
+    std::ifstream file(fileName);
+    if (!file.is_open()) return false;
+    std::string line;
+    while (std::getline(file, line)) {
+        size_t name = line.find("\"name\": \"");
+        size_t value = line.find("\"nsPerPixel\": ");
+        if (name == std::string::npos || value == std::string::npos) continue;
+        name += strlen("\"name\": \"");
+        size_t nameEnd = line.find('"', name);
+        if (nameEnd == std::string::npos) continue;
+        nsPerPixel[line.substr(name, nameEnd - name)] = atof(line.c_str() + value + strlen("\"nsPerPixel\": "));
+    }
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    std::string filter;
+    double minTimeMs = 500.0;
+    int threads = 0;
+    std::string saveFile;
+    std::string baselineFile;
+    double threshold = 10.0;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--filter" && hasValue) {
+            filter = argv[++i];
+        }
+        else if (arg == "--min-time" && hasValue) {
+            minTimeMs = atof(argv[++i]);
+        }
+        else if (arg == "--threads" && hasValue) {
+            threads = atoi(argv[++i]);
+        }
+        else if (arg == "--save" && hasValue) {
+            saveFile = argv[++i];
+        }
+        else if (arg == "--baseline" && hasValue) {
+            baselineFile = argv[++i];
+        }
+        else if (arg == "--threshold" && hasValue) {
+            threshold = atof(argv[++i]);
+        }
+        else {
+            printUsage();
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+
+    std::map<std::string, double> baseline;
+    if (!baselineFile.empty() && !loadBaseline(baselineFile, baseline)) {
+        printf("[ERR] Read baseline %s failed\n", baselineFile.c_str());
+        return 1;
+    }
+    if (threads > 0) cv::setNumThreads(threads);
+    printf("OpenCV threads: %d\n", cv::getNumThreads());
+    printf("%-32s %10s %12s %10s %10s", "benchmark", "runs", "ns/pixel", "Mpix/s", "MB/s");
+    if (!baseline.empty()) printf(" %10s", "change");
+    printf("\n");
+
+    std::vector<BenchResult_S> results;
+    int regressions = 0;
+    for (const Bench_S& bench : makeBenchmarks()) {
+        if (!filter.empty() && bench.name.find(filter) == std::string::npos) continue;
+        BenchResult_S result = runBenchmark(bench, minTimeMs);
+        results.push_back(result);
+        printf("%-32s %10d %12.3f %10.1f %10.1f", result.name.c_str(), result.iterations, result.nsPerPixel, result.mpixPerSec, result.mbPerSec);
+
+        std::map<std::string, double>::const_iterator it = baseline.find(result.name);
+        if (it != baseline.end() && it->second > 0.0) {
+            double change = (result.nsPerPixel / it->second - 1.0) * 100.0;
+            bool isRegression = change > threshold;
+            if (isRegression) regressions++;
+            printf(" %+9.1f%%%s", change, isRegression ? "  REGRESSION" : "");
+        }
+        else if (!baseline.empty()) {
+            printf(" %10s", "new");
+        }
+        printf("\n");
+    }
+    remove("bench_points.ply");
+
+    if (!saveFile.empty() && !saveResults(results, saveFile)) {
+        printf("[ERR] Write %s failed\n", saveFile.c_str());
+        return 1;
+    }
+    if (regressions > 0) {
+        printf("%d benchmark(s) slower than the baseline by more than %.1f%%\n", regressions, threshold);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,201 @@
+// Headless front end of the viewer core: streams, converts and records without a window or OpenGL.
+//
+// orbbec_sample_cli [--device N] [--streams color,depth,ir] [--duration S] [--callback]
+//                   [--record N] [--stats FILE] [--trace FILE]
+//                   [--synthetic [--size WxH] [--fps F] [--color-format F] [--ir-format F]
+//                    [--noise N] [--drop R] [--jitter MS] [--seed N]]
+#include "service.h"
+#include "synthetic_source.h"
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <thread>
+#include <chrono>
+#include <atomic>
+
+static std::atomic<bool> g_isInterrupted{ false };
+
+static void onInterrupt(int)
+{
+    g_isInterrupted = true;
+}
+
+static void printUsage()
+{
+    printf("Usage: orbbec_sample_cli [options]\n");
+    printf("  --device N         device index (default 0)\n");
+    printf("  --streams LIST     comma separated color,depth,ir (default color,depth)\n");
+    printf("  --duration S       seconds to stream, 0 runs until Ctrl+C (default 10)\n");
+    printf("  --callback         pipeline callback acquisition instead of polling\n");
+    printf("  --record N         save N frames of every stream to CapturedFrames\n");
+    printf("  --stats FILE       write the stream stats JSON at exit\n");
+    printf("  --trace FILE       record trace markers and write them at exit\n");
+    printf("  --synthetic        generated test patterns instead of a device, options below\n");
+    printf("  --size WxH         frame size of every stream (default 640x480)\n");
+    printf("  --fps F            frame rate of every stream (default 30)\n");
+    printf("  --color-format F   MJPG, YUYV, UYVY, NV21, NV12, I420 or RGB888 (default RGB888)\n");
+    printf("  --ir-format F      Y16, Y8 or MJPG (default Y16)\n");
+    printf("  --noise N          uniform noise amplitude in pixel values (default 0)\n");
+    printf("  --drop R           probability of dropping a frame, 0 to 1 (default 0)\n");
+    printf("  --jitter MS        delivery delay up to MS after the capture time (default 0)\n");
+    printf("  --seed N           seed of the patterns, noise, drops and jitter (default 1)\n");
+}
+
+int main(int argc, char** argv)
+{
+    static const char* streamNames[STREAM_COUNT] = { "color", "depth", "ir" };
+    int deviceIndex = 0;
+    bool isStreamOn[STREAM_COUNT] = { true, true, false };
+    double duration = 10.0;
+    bool isCallback = false;
+    int recordFrames = 0;
+    std::string statsFile;
+    std::string traceFile;
+    bool isSynthetic = false;
+    SyntheticStreamConfig_S synthetic;
+    OBFormat colorFormat = OB_FORMAT_UNKNOWN;
+    OBFormat irFormat = OB_FORMAT_UNKNOWN;
+    uint32_t seed = 1;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--device" && hasValue) {
+            deviceIndex = atoi(argv[++i]);
+        }
+        else if (arg == "--streams" && hasValue) {
+            std::string list = argv[++i];
+            for (int n = 0; n < STREAM_COUNT; n++) {
+                isStreamOn[n] = list.find(streamNames[n]) != std::string::npos;
+            }
+        }
+        else if (arg == "--duration" && hasValue) {
+            duration = atof(argv[++i]);
+        }
+        else if (arg == "--callback") {
+            isCallback = true;
+        }
+        else if (arg == "--record" && hasValue) {
+            recordFrames = atoi(argv[++i]);
+        }
+        else if (arg == "--stats" && hasValue) {
+            statsFile = argv[++i];
+        }
+        else if (arg == "--trace" && hasValue) {
+            traceFile = argv[++i];
+        }
+        else if (arg == "--synthetic") {
+            isSynthetic = true;
+        }
+        else if (arg == "--size" && hasValue) {
+            if (sscanf(argv[++i], "%dx%d", &synthetic.width, &synthetic.height) != 2) {
+                printUsage();
+                return 1;
+            }
+        }
+        else if (arg == "--fps" && hasValue) {
+            synthetic.fps = atof(argv[++i]);
+        }
+        else if (arg == "--color-format" && hasValue) {
+            colorFormat = stringToOBFormat(argv[++i]);
+        }
+        else if (arg == "--ir-format" && hasValue) {
+            irFormat = stringToOBFormat(argv[++i]);
+        }
+        else if (arg == "--noise" && hasValue) {
+            synthetic.noise = atoi(argv[++i]);
+        }
+        else if (arg == "--drop" && hasValue) {
+            synthetic.dropRate = atof(argv[++i]);
+        }
+        else if (arg == "--jitter" && hasValue) {
+            synthetic.jitterMs = atof(argv[++i]);
+        }
+        else if (arg == "--seed" && hasValue) {
+            seed = (uint32_t)strtoul(argv[++i], NULL, 10);
+        }
+        else {
+            printUsage();
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+
+    signal(SIGINT, onInterrupt);
+    if (!traceFile.empty()) TraceRecorder::setRecording(true);
+
+    int state = 0;
+    Service* service = NULL;
+    if (isSynthetic) {
+        std::shared_ptr<SyntheticFrameSource> source = std::make_shared<SyntheticFrameSource>(seed);
+        for (int n = 0; n < STREAM_COUNT; n++) {
+            SyntheticStreamConfig_S config = synthetic;
+            config.format = n == STREAM_COLOR ? colorFormat : n == STREAM_IR ? irFormat : OB_FORMAT_Y16;
+            source->setStreamConfig((StreamIndex)n, config);
+        }
+        service = new Service(source);
+        printf("Device: %s, %dx%d @ %.1f fps\n", service->getSensorName().c_str(), synthetic.width, synthetic.height, synthetic.fps);
+    }
+    else {
+        service = new Service(state, deviceIndex);
+        // The enumerator may still be reporting the device, give it a moment
+        for (int retry = 0; state == INIT_RESULT_NO_DEVICE && retry < 50 && !g_isInterrupted; retry++) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            if ((int)service->getSensorStrList()->size() > deviceIndex) state = service->initCamera(deviceIndex);
+        }
+        if (state != 0) {
+            printf("[ERR] Open device %d failed: %d\n", deviceIndex, state);
+            delete service;
+            return 1;
+        }
+        printf("Device: %s (%s), firmware %s\n", service->getSensorName().c_str(), service->getSerialNum().c_str(), service->getFirmwareVer().c_str());
+    }
+
+    if (isCallback) service->setAcquisitionMode(ACQUISITION_CALLBACK, 8, FRAME_RING_KEEP_ALL);
+    service->beginReconfiguration();
+    if (isStreamOn[STREAM_COLOR]) service->switchColorStream(true);
+    if (isStreamOn[STREAM_DEPTH]) service->switchDepthStream(true);
+    if (isStreamOn[STREAM_IR]) service->switchIRStream(true);
+    service->commitReconfiguration();
+
+    if (recordFrames > 0) service->startFrameCapturing(isStreamOn, recordFrames);
+
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point report = begin;
+    while (!g_isInterrupted) {
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        double elapsed = std::chrono::duration<double>(now - begin).count();
+        if (duration > 0 && elapsed >= duration) break;
+
+        // Same consumer calls the GUI makes once per frame; they drive capturing too
+        service->readFrame();
+        if (isStreamOn[STREAM_COLOR]) service->getColorMat();
+        if (isStreamOn[STREAM_DEPTH]) service->getDepthMat();
+        if (isStreamOn[STREAM_IR]) service->getIRMat();
+
+        if (std::chrono::duration<double>(now - report).count() >= 1.0) {
+            report = now;
+            printf("%6.1f s", elapsed);
+            for (int n = 0; n < STREAM_COUNT; n++) {
+                if (!isStreamOn[n]) continue;
+                StreamStats_S stats = service->getStreamStats((StreamIndex)n);
+                printf(" | %s %.1f fps, gaps %llu, host %llu, p99 %.1f ms", streamNames[n], stats.fps,
+                    (unsigned long long)stats.deviceDropped, (unsigned long long)stats.hostDropped, stats.deliveryP99);
+            }
+            printf("\n");
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    if (!statsFile.empty()) service->dumpStreamStats(statsFile);
+
+    service->beginReconfiguration();
+    if (isStreamOn[STREAM_COLOR]) service->switchColorStream(false);
+    if (isStreamOn[STREAM_DEPTH]) service->switchDepthStream(false);
+    if (isStreamOn[STREAM_IR]) service->switchIRStream(false);
+    service->commitReconfiguration();
+    delete service;
+
+    if (!traceFile.empty()) TraceRecorder::dump(traceFile);
+    return 0;
+}
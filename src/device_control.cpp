@@ -0,0 +1,153 @@
+#include "device_control.h"
+#include <iostream>
+
+DeviceControlQueue::DeviceControlQueue()
+{
+    m_bIsRunning = true;
+    m_controlThread = std::thread(&DeviceControlQueue::controlLoop, this);
+}
+
+DeviceControlQueue::~DeviceControlQueue()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_bIsRunning = false;
+    }
+    m_cond.notify_all();
+    if (m_controlThread.joinable()) {
+        m_controlThread.join();
+    }
+}
+
+void DeviceControlQueue::setDevice(std::shared_ptr<ob::Device> device)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_device = device;
+    m_queue.clear();
+    m_status.clear();
+    m_pendingCount = m_bIsWriting ? 1 : 0;
+    m_idleCond.notify_all();
+}
+
+void DeviceControlQueue::setIntProperty(OBPropertyID id, int value, const char* name)
+{
+    ControlWrite_S write = { id, false, value, name, nullptr };
+    queueWrite(write);
+}
+
+void DeviceControlQueue::setBoolProperty(OBPropertyID id, bool value, const char* name)
+{
+    ControlWrite_S write = { id, true, value ? 1 : 0, name, nullptr };
+    queueWrite(write);
+}
+
+void DeviceControlQueue::post(ControlTask task, const char* name)
+{
+    ControlWrite_S write = { (OBPropertyID)0, false, 0, name, task };
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_queue.push_back(write);
+    m_pendingCount = m_queue.size() + (m_bIsWriting ? 1 : 0);
+    m_cond.notify_all();
+}
+
+void DeviceControlQueue::queueWrite(const ControlWrite_S& write)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto it = m_queue.begin(); it != m_queue.end(); ++it) {
+        if (!it->task && it->id == write.id) {
+            m_queue.erase(it);
+            break;
+        }
+    }
+    m_queue.push_back(write);
+    m_status[write.id] = CONTROL_PENDING;
+    m_pendingCount = m_queue.size() + (m_bIsWriting ? 1 : 0);
+    m_cond.notify_all();
+}
+
+ControlStatus DeviceControlQueue::getStatus(OBPropertyID id)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_status.find(id);
+    return it != m_status.end() ? it->second : CONTROL_IDLE;
+}
+
+void DeviceControlQueue::waitIdle()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_idleCond.wait(lock, [this] { return !m_bIsRunning || (m_queue.empty() && !m_bIsWriting); });
+}
+
+void DeviceControlQueue::controlLoop()
+{
+    while (true) {
+        ControlWrite_S write;
+        std::shared_ptr<ob::Device> device;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cond.wait(lock, [this] { return !m_bIsRunning || !m_queue.empty(); });
+            if (!m_bIsRunning) break;
+            write = m_queue.front();
+            m_queue.pop_front();
+            device = m_device;
+            m_bIsWriting = true;
+        }
+
+        if (write.task) {
+            try {
+                write.task(device);
+            }
+            catch (ob::Error& e) {
+                std::cerr << write.name << ": " << e.getName() << "\nargs:" << e.getArgs() << "\nmessage:" << e.getMessage() << "\ntype:" << e.getExceptionType() << std::endl;
+            }
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_bIsWriting = false;
+            m_pendingCount = m_queue.size();
+            if (m_queue.empty()) m_idleCond.notify_all();
+            continue;
+        }
+
+        ControlStatus status = CONTROL_FAILED;
+        try {
+            if (device == nullptr) {
+                printf("[ERR] Set %s property failed, no device.\n", write.name);
+            }
+            else if (!device->isPropertySupported(write.id, OB_PERMISSION_WRITE)) {
+                printf("[ERR] Set %s property not supported.\n", write.name);
+                status = CONTROL_UNSUPPORTED;
+            }
+            else {
+                if (write.isBool)
+                    device->setBoolProperty(write.id, write.value != 0);
+                else
+                    device->setIntProperty(write.id, write.value);
+                status = CONTROL_DONE;
+            }
+        }
+        catch (...) {
+            printf("[ERR] Set %s property failed.\n", write.name);
+        }
+
+        // Run before the write counts as finished so waitIdle() callers see its side effects
+        if (m_completionCallback) m_completionCallback(write.id, write.value, status);
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_bIsWriting = false;
+            // A newer write to the same property may be queued already, keep it pending
+            bool bIsRequeued = false;
+            for (auto it = m_queue.begin(); it != m_queue.end(); ++it) {
+                if (!it->task && it->id == write.id) bIsRequeued = true;
+            }
+            if (!bIsRequeued && device == m_device) m_status[write.id] = status;
+            m_pendingCount = m_queue.size();
+            if (m_queue.empty()) m_idleCond.notify_all();
+        }
+    }
+
+    // Release anyone waiting for writes that will never run
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_queue.clear();
+    m_pendingCount = 0;
+    m_idleCond.notify_all();
+}
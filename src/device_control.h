@@ -0,0 +1,76 @@
+#pragma once
+#include "libobsensor/ObSensor.hpp"
+#include "libobsensor/hpp/Error.hpp"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <deque>
+#include <map>
+
+typedef enum {
+    CONTROL_IDLE = 0,           // Nothing was written to the property yet
+    CONTROL_PENDING = 1,        // Queued or being written
+    CONTROL_DONE = 2,
+    CONTROL_FAILED = 3,
+    CONTROL_UNSUPPORTED = 4,
+} ControlStatus;
+
+// Writes device properties on a dedicated control thread so callers never wait on a USB control transfer.
+// A write to a property that is still queued replaces the queued value (last value wins) and moves
+// it behind the other queued writes, so the device sees the final values in the order they were last set.
+class DeviceControlQueue
+{
+public:
+    typedef std::function<void(OBPropertyID id, int value, ControlStatus status)> CompletionCallback;
+    // Runs on the control thread with the device of the queue, which may be null
+    typedef std::function<void(std::shared_ptr<ob::Device> device)> ControlTask;
+
+    DeviceControlQueue();
+    ~DeviceControlQueue();
+
+    // Queued writes for a previous device are discarded
+    void setDevice(std::shared_ptr<ob::Device> device);
+
+    // name is used in error messages and must outlive the write
+    void setIntProperty(OBPropertyID id, int value, const char* name);
+    void setBoolProperty(OBPropertyID id, bool value, const char* name);
+    // Device access other than a property write, run in order with the writes and never coalesced.
+    // Discarded like a write when the device changes
+    void post(ControlTask task, const char* name);
+
+    // Status of the newest write to a property
+    ControlStatus getStatus(OBPropertyID id);
+    inline size_t getPendingCount() { return m_pendingCount; }
+    // Block until every queued write was done, for direct device access that must come after them.
+    // Never call it on the UI thread, show getStatus() instead
+    void waitIdle();
+    // Called on the control thread after each write with the value written, before waitIdle() returns; set before writes are queued
+    inline void setCompletionCallback(CompletionCallback callback) { m_completionCallback = callback; }
+
+private:
+    typedef struct ControlWrite_S {
+        OBPropertyID id;
+        bool isBool;
+        int value;
+        const char* name;
+        ControlTask task;           // set for posted tasks, id and value are unused then
+    } ControlWrite_S;
+
+    void queueWrite(const ControlWrite_S& write);
+    void controlLoop();
+
+private:
+    std::thread m_controlThread;
+    std::mutex m_mutex;                 // guards everything below
+    std::condition_variable m_cond;
+    std::condition_variable m_idleCond;
+    bool m_bIsRunning = false;
+    bool m_bIsWriting = false;
+    std::shared_ptr<ob::Device> m_device;
+    std::deque<ControlWrite_S> m_queue;
+    std::map<OBPropertyID, ControlStatus> m_status;
+    std::atomic<size_t> m_pendingCount{ 0 };
+    CompletionCallback m_completionCallback;
+};
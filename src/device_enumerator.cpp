@@ -0,0 +1,154 @@
+#include "device_enumerator.h"
+
+DeviceEnumerator::DeviceEnumerator()
+{
+    try {
+        m_context = std::make_shared<ob::Context>();
+        // Initial list is needed right away to open the first device
+        rebuildDeviceList();
+        m_context->setDeviceChangedCallback([this](std::shared_ptr<ob::DeviceList> removedList, std::shared_ptr<ob::DeviceList> addedList) {
+            onDeviceChanged(removedList, addedList);
+        });
+    }
+    catch (ob::Error& e) {
+        std::cerr << "DeviceEnumerator: " << e.getName() << "\nargs:" << e.getArgs() << "\nmessage:" << e.getMessage() << "\ntype:" << e.getExceptionType() << std::endl;
+    }
+
+    m_bIsRunning = true;
+    m_enumerationThread = std::thread(&DeviceEnumerator::enumerationLoop, this);
+}
+
+DeviceEnumerator::~DeviceEnumerator()
+{
+    try {
+        if (m_context) m_context->setDeviceChangedCallback(nullptr);
+    }
+    catch (ob::Error& e) {
+        std::cerr << "~DeviceEnumerator: " << e.getName() << "\nargs:" << e.getArgs() << "\nmessage:" << e.getMessage() << "\ntype:" << e.getExceptionType() << std::endl;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_bIsRunning = false;
+    }
+    m_cond.notify_all();
+    if (m_enumerationThread.joinable()) {
+        m_enumerationThread.join();
+    }
+}
+
+std::shared_ptr<ob::DeviceList> DeviceEnumerator::getDeviceList()
+{
+    std::lock_guard<std::mutex> lock(m_listMutex);
+    return m_deviceList;
+}
+
+std::vector<std::string> DeviceEnumerator::getDeviceStrList()
+{
+    std::lock_guard<std::mutex> lock(m_listMutex);
+    return m_deviceStringList;
+}
+
+std::vector<std::string> DeviceEnumerator::getSerialList()
+{
+    std::lock_guard<std::mutex> lock(m_listMutex);
+    return m_serialList;
+}
+
+int DeviceEnumerator::addDeviceChangedListener(DeviceChangedListener listener)
+{
+    std::lock_guard<std::mutex> lock(m_listenerMutex);
+    m_listeners[m_nextListenerId] = listener;
+    return m_nextListenerId++;
+}
+
+void DeviceEnumerator::removeDeviceChangedListener(int id)
+{
+    std::lock_guard<std::mutex> lock(m_listenerMutex);
+    m_listeners.erase(id);
+}
+
+// Runs on the SDK thread, only record what changed
+void DeviceEnumerator::onDeviceChanged(std::shared_ptr<ob::DeviceList> removedList, std::shared_ptr<ob::DeviceList> addedList)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    try {
+        for (uint32_t i = 0; removedList != nullptr && i < removedList->deviceCount(); i++) {
+            m_pendingRemoved.push_back(removedList->serialNumber(i));
+        }
+        for (uint32_t i = 0; addedList != nullptr && i < addedList->deviceCount(); i++) {
+            m_pendingAdded.push_back(addedList->serialNumber(i));
+        }
+    }
+    catch (ob::Error& e) {
+        std::cerr << "onDeviceChanged: " << e.getName() << "\nargs:" << e.getArgs() << "\nmessage:" << e.getMessage() << "\ntype:" << e.getExceptionType() << std::endl;
+    }
+    m_bIsChangePending = true;
+    m_cond.notify_all();
+}
+
+void DeviceEnumerator::enumerationLoop()
+{
+    while (true) {
+        std::vector<std::string> removed, added;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cond.wait(lock, [this] { return !m_bIsRunning || m_bIsChangePending; });
+            if (!m_bIsRunning) break;
+            removed.swap(m_pendingRemoved);
+            added.swap(m_pendingAdded);
+            m_bIsChangePending = false;
+        }
+
+        // A replugged device may come back on another port
+        for (size_t i = 0; i < added.size(); i++) {
+            m_usbTypeCache.erase(added[i]);
+        }
+        rebuildDeviceList();
+
+        std::lock_guard<std::mutex> lock(m_listenerMutex);
+        for (auto it = m_listeners.begin(); it != m_listeners.end(); ++it) {
+            it->second(removed, added);
+        }
+    }
+}
+
+void DeviceEnumerator::rebuildDeviceList()
+{
+    if (m_context == nullptr) return;
+
+    std::shared_ptr<ob::DeviceList> deviceList;
+    std::vector<std::string> deviceStringList;
+    std::vector<std::string> serialList;
+    try {
+        // Query all connected device list
+        deviceList = m_context->queryDeviceList();
+        int devCount = deviceList->deviceCount();
+        for (int i = 0; i < devCount; i++) {
+            std::string serialNum = deviceList->serialNumber(i);
+            // USB type needs an opened device, which is done only once per connection
+            if (m_usbTypeCache.find(serialNum) == m_usbTypeCache.end()) {
+                auto device = deviceList->getDevice(i);
+                m_usbTypeCache[serialNum] = device->getDeviceInfo()->usbType();
+                device.reset();
+            }
+
+            std::string deviceName = deviceList->name(i);
+            deviceName.append(" #SN:").append(serialNum).append(" USB:").append(m_usbTypeCache[serialNum]);
+            deviceStringList.push_back(deviceName);
+            serialList.push_back(serialNum);
+        }
+    }
+    catch (ob::Error& e) {
+        std::cerr << "rebuildDeviceList: " << e.getName() << "\nargs:" << e.getArgs() << "\nmessage:" << e.getMessage() << "\ntype:" << e.getExceptionType() << std::endl;
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_listMutex);
+        m_deviceList = deviceList;
+        m_deviceStringList.swap(deviceStringList);
+        m_serialList.swap(serialList);
+    }
+    m_generation++;
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include "libobsensor/ObSensor.hpp"
+#include "libobsensor/hpp/Error.hpp"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <map>
+#include <vector>
+#include <string>
+#include <iostream>
+
+// Owns the SDK context and keeps the list of connected devices current.
+// The SDK device changed callback only queues the change; the list is rebuilt and the
+// listeners run on the enumerator thread, so neither the SDK nor the UI thread blocks on it.
+class DeviceEnumerator
+{
+public:
+    // Serial numbers of the devices that went away and came in with one notification
+    typedef std::function<void(const std::vector<std::string>& removed, const std::vector<std::string>& added)> DeviceChangedListener;
+
+    DeviceEnumerator();
+    ~DeviceEnumerator();
+
+    inline std::shared_ptr<ob::Context> getContext() { return m_context; }
+    std::shared_ptr<ob::DeviceList> getDeviceList();
+    std::vector<std::string> getDeviceStrList();
+    std::vector<std::string> getSerialList();
+    // Bumped every time the device list was rebuilt
+    inline uint32_t getGeneration() { return m_generation; }
+
+    // Listeners run on the enumerator thread; removing one waits until it is no longer running
+    int addDeviceChangedListener(DeviceChangedListener listener);
+    void removeDeviceChangedListener(int id);
+
+private:
+    void onDeviceChanged(std::shared_ptr<ob::DeviceList> removedList, std::shared_ptr<ob::DeviceList> addedList);
+    void enumerationLoop();
+    void rebuildDeviceList();
+
+private:
+    std::shared_ptr<ob::Context> m_context;
+    std::thread m_enumerationThread;
+    std::atomic<bool> m_bIsRunning{ false };
+
+    std::mutex m_mutex;             // guards the pending changes below
+    std::condition_variable m_cond;
+    bool m_bIsChangePending = false;
+    std::vector<std::string> m_pendingRemoved;
+    std::vector<std::string> m_pendingAdded;
+
+    std::mutex m_listMutex;         // guards the published device list
+    std::shared_ptr<ob::DeviceList> m_deviceList;
+    std::vector<std::string> m_deviceStringList;
+    std::vector<std::string> m_serialList;
+    std::atomic<uint32_t> m_generation{ 0 };
+    std::map<std::string, std::string> m_usbTypeCache;      // serial number to USB type, enumerator thread only
+
+    std::mutex m_listenerMutex;     // held while listeners run
+    std::map<int, DeviceChangedListener> m_listeners;
+    int m_nextListenerId = 0;
+};
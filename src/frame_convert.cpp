@@ -0,0 +1,254 @@
+#include "frame_convert.h"
+#include <algorithm>
+#include <cmath>
+
+int selectJpegReduction(int width, int height, int displayWidth, int displayHeight)
+{
+	if (displayWidth <= 0 || displayHeight <= 0) return 1;
+	for (int reduction = 8; reduction > 1; reduction /= 2) {
+		if (width / reduction >= displayWidth && height / reduction >= displayHeight) return reduction;
+	}
+	return 1;
+}
+
+// Decodes into the existing buffer of image; reduced sizes are scaled in the DCT domain by libjpeg
+void decodeJpeg(const cv::Mat& data, cv::Mat& image, int reduction)
+{
+	int flags = reduction >= 8 ? cv::IMREAD_REDUCED_COLOR_8 : reduction >= 4 ? cv::IMREAD_REDUCED_COLOR_4 :
+		reduction >= 2 ? cv::IMREAD_REDUCED_COLOR_2 : cv::IMREAD_COLOR;
+#if CV_VERSION_MAJOR > 4 || (CV_VERSION_MAJOR == 4 && CV_VERSION_MINOR >= 11)
+	// The decoder writes RGB itself, IMREAD_COLOR_RGB exists since OpenCV 4.11
+	if (flags == cv::IMREAD_COLOR) {
+		cv::imdecode(data, cv::IMREAD_COLOR_RGB, &image);
+		return;
+	}
+#endif
+	cv::imdecode(data, flags, &image);
+	if (!image.empty()) cv::cvtColor(image, image, cv::COLOR_BGR2RGB);
+}
+
+// cvtColor code from a YUV layout straight to RGB, -1 for other formats.
+// OpenCV converts these in one SIMD pass split over its worker threads.
+int yuvToRGBCode(OBFormat format)
+{
+	switch (format) {
+	case OB_FORMAT_NV21:
+		return cv::COLOR_YUV2RGB_NV21;
+	case OB_FORMAT_NV12:
+		return cv::COLOR_YUV2RGB_NV12;
+	case OB_FORMAT_I420:
+		return cv::COLOR_YUV2RGB_I420;
+	case OB_FORMAT_YUYV:
+	case OB_FORMAT_YUY2:
+		return cv::COLOR_YUV2RGB_YUY2;
+	case OB_FORMAT_UYVY:
+		return cv::COLOR_YUV2RGB_UYVY;
+	default:
+		return -1;
+	}
+}
+
+void convertColorFrame(ImageSlot_S& slot, int reduction)
+{
+	const FrameSlot_S& frame = slot.frame;
+	if (frame.type != OB_FRAME_COLOR) return;
+
+	int yuvCode = yuvToRGBCode(frame.format);
+	if (frame.format == OB_FORMAT_MJPG) {
+		slot.raw = cv::Mat(1, frame.dataSize, CV_8UC1, (void*)frame.data);
+		decodeJpeg(slot.raw, slot.image, reduction);
+	}
+	else if (yuvCode >= 0) {
+		// 4:2:0 layouts are a full size Y plane followed by the chroma, 4:2:2 layouts are packed
+		bool is420 = frame.format == OB_FORMAT_NV21 || frame.format == OB_FORMAT_NV12 || frame.format == OB_FORMAT_I420;
+		if (is420)
+			slot.raw = cv::Mat(frame.height * 3 / 2, frame.width, CV_8UC1, (void*)frame.data);
+		else
+			slot.raw = cv::Mat(frame.height, frame.width, CV_8UC2, (void*)frame.data);
+		if (frame.dataSize < slot.raw.total() * slot.raw.elemSize()) {
+			slot.raw.release();
+			return;
+		}
+		cv::cvtColor(slot.raw, slot.image, yuvCode);
+	}
+	else if (frame.format == OB_FORMAT_RGB888) {
+		// The image outlives the SDK buffer in the reused slot, so it gets its own copy
+		slot.raw = cv::Mat(frame.height, frame.width, CV_8UC3, (void*)frame.data);
+		slot.raw.copyTo(slot.image);
+	}
+	else if (frame.format == OB_FORMAT_BGR) {
+		slot.raw = cv::Mat(frame.height, frame.width, CV_8UC3, (void*)frame.data);
+		cv::cvtColor(slot.raw, slot.image, cv::COLOR_BGR2RGB);
+	}
+}
+
+cv::Mat depthColormapPalette(DepthColormapType colormap)
+{
+	cv::Mat ramp(1, 256, CV_8UC1), bgr, rgb;
+	for (int i = 0; i < 256; i++) {
+		ramp.at<uint8_t>(0, i) = (uint8_t)(colormap == DEPTH_COLORMAP_INVERSE ? 255 - i : i);
+	}
+	if (colormap == DEPTH_COLORMAP_GRAYSCALE || colormap == DEPTH_COLORMAP_INVERSE) {
+		cv::cvtColor(ramp, rgb, cv::COLOR_GRAY2RGB);
+		return rgb;
+	}
+	cv::applyColorMap(ramp, bgr, colormap == DEPTH_COLORMAP_TURBO ? cv::COLORMAP_TURBO : cv::COLORMAP_JET);
+	cv::cvtColor(bgr, rgb, cv::COLOR_BGR2RGB);
+	return rgb;
+}
+
+const char* depthColormapName(DepthColormapType colormap)
+{
+	static const char* names[DEPTH_COLORMAP_COUNT] = { "Jet", "Turbo", "Grayscale", "Inverse", "Wrapped" };
+	return colormap >= 0 && colormap < DEPTH_COLORMAP_COUNT ? names[colormap] : "";
+}
+
+const cv::Vec3b* DepthColorLut::get(const DepthColorParam_S& param, float valueScale)
+{
+	bool isValid = !mTable.empty() && mValueScale == valueScale && mParam.colormap == param.colormap
+		&& mParam.dispRange[0] == param.dispRange[0] && mParam.dispRange[1] == param.dispRange[1]
+		&& mParam.invalidColor == param.invalidColor;
+	if (isValid) return mTable.data();
+
+	mParam = param;
+	mValueScale = valueScale;
+	mTable.resize(65536);
+
+	cv::Mat palette = depthColormapPalette(param.colormap);
+	const cv::Vec3b* colors = palette.ptr<cv::Vec3b>(0);
+	float low = (float)param.dispRange[0];
+	float high = (float)param.dispRange[1];
+	float span = param.colormap == DEPTH_COLORMAP_WRAPPED ? (float)DEPTH_WRAP_MM : std::max(high - low, 1.0f);
+
+	// 0 is no depth
+	mTable[0] = param.invalidColor;
+	for (int value = 1; value < 65536; value++) {
+		// depth frame pixel value multiply scale to get distance in millimeter
+		float distance = value * valueScale;
+		if (distance < low || distance > high) {
+			mTable[value] = param.invalidColor;
+			continue;
+		}
+		float position = (distance - low) / span;
+		if (param.colormap == DEPTH_COLORMAP_WRAPPED) position -= std::floor(position);
+		mTable[value] = colors[std::min((int)(position * 255.0f + 0.5f), 255)];
+	}
+	return mTable.data();
+}
+
+// One lookup per pixel, row bands in parallel
+void colorizeDepth(const cv::Mat& depth, cv::Mat& image, const cv::Vec3b* table)
+{
+	const int width = depth.cols;
+	image.create(depth.rows, depth.cols, CV_8UC3);
+	cv::parallel_for_(cv::Range(0, depth.rows), [&](const cv::Range& rows) {
+		for (int y = rows.start; y < rows.end; y++) {
+			const uint16_t* src = depth.ptr<uint16_t>(y);
+			cv::Vec3b* dst = image.ptr<cv::Vec3b>(y);
+			for (int x = 0; x < width; x++) {
+				dst[x] = table[src[x]];
+			}
+		}
+	}, std::max(1, depth.rows / 32));
+}
+
+void convertDepthFrame(ImageSlot_S& slot, const DepthColorParam_S& param)
+{
+	// One table per convert worker, they only change with the display settings
+	static thread_local DepthColorLut colorLut;
+	const FrameSlot_S& frame = slot.frame;
+
+	if (frame.format == OB_FORMAT_Y16) {
+		slot.raw = cv::Mat(frame.height, frame.width, CV_16UC1, (void*)frame.data);
+		colorizeDepth(slot.raw, slot.image, colorLut.get(param, frame.valueScale));
+	}
+}
+
+bool wrapRawFrame(ImageSlot_S& slot)
+{
+	const FrameSlot_S& frame = slot.frame;
+	bool isPacked422 = frame.type == OB_FRAME_COLOR
+		&& (frame.format == OB_FORMAT_YUYV || frame.format == OB_FORMAT_YUY2 || frame.format == OB_FORMAT_UYVY);
+	bool isY16 = (frame.type == OB_FRAME_DEPTH || is_ir_frame(frame.type)) && frame.format == OB_FORMAT_Y16;
+	bool isY8 = is_ir_frame(frame.type) && frame.format == OB_FORMAT_Y8;
+	if (!isPacked422 && !isY16 && !isY8) return false;
+
+	slot.raw = cv::Mat(frame.height, frame.width, isPacked422 ? CV_8UC2 : isY16 ? CV_16UC1 : CV_8UC1, (void*)frame.data);
+	if (frame.dataSize < slot.raw.total() * slot.raw.elemSize()) {
+		slot.raw.release();
+		return false;
+	}
+	slot.image.release();
+	return true;
+}
+
+void convertIRFrame(ImageSlot_S& slot)
+{
+	const FrameSlot_S& frame = slot.frame;
+
+	if (frame.format == OB_FORMAT_Y16 || frame.format == OB_FORMAT_YUYV || frame.format == OB_FORMAT_YUY2) {
+		cv::Mat cvtMat;
+		slot.raw = cv::Mat(frame.height, frame.width, CV_16UC1, (void*)frame.data);
+		float scale = 1.0f / (float)pow(2, frame.pixelBitSize - 8);
+		cv::convertScaleAbs(slot.raw, cvtMat, scale);
+		cv::cvtColor(cvtMat, slot.image, cv::COLOR_GRAY2RGB);
+	}
+
+	if (is_ir_frame(frame.type) && frame.format == OB_FORMAT_Y8) {
+		slot.raw = cv::Mat(frame.height, frame.width, CV_8UC1, (void*)frame.data);
+
+		cv::cvtColor(slot.raw, slot.image, cv::COLOR_GRAY2RGB);
+	}
+	else if (is_ir_frame(frame.type) && frame.format == OB_FORMAT_MJPG) {
+		slot.raw = cv::Mat(1, frame.dataSize, CV_8UC1, (void*)frame.data);
+		decodeJpeg(slot.raw, slot.image, 1);
+	}
+}
+
+void applyDepthFilter(cv::Mat& image, DepthFilterType filter, int filterSize)
+{
+	if (image.empty()) return;
+
+	if (filter == DEPTH_FILTER_GAUSSIAN) {
+		// Gaussian kernel size has to be odd
+		filterSize |= 1;
+		cv::GaussianBlur(image, image, cv::Size(filterSize, filterSize), 0, 0);
+	}
+	else if (filter == DEPTH_FILTER_BLUR) {
+		cv::blur(image, image, cv::Size(filterSize, filterSize));
+	}
+}
+
+void convertTextureImage(const cv::Mat& source, cv::Mat& target)
+{
+	if (source.channels() == 3)
+		target = source;
+	else if (source.channels() == 1)
+		cv::cvtColor(source, target, CV_GRAY2RGB);
+	else
+		target.release();
+}
+
+void savePointsToPly(const OBColorPoint* points, size_t count, const std::string& fileName)
+{
+	int   pointsSize = (int)count;
+	FILE* fp = fopen(fileName.c_str(), "wb+");
+	if (fp == NULL) return;
+	fprintf(fp, "ply\n");
+	fprintf(fp, "format ascii 1.0\n");
+	fprintf(fp, "element vertex %d\n", pointsSize);
+	fprintf(fp, "property float x\n");
+	fprintf(fp, "property float y\n");
+	fprintf(fp, "property float z\n");
+	fprintf(fp, "property uchar red\n");
+	fprintf(fp, "property uchar green\n");
+	fprintf(fp, "property uchar blue\n");
+	fprintf(fp, "end_header\n");
+
+	for (int i = 0; i < pointsSize; i++) {
+		fprintf(fp, "%.3f %.3f %.3f %d %d %d\n", points[i].x, points[i].y, points[i].z, (int)points[i].r, (int)points[i].g, (int)points[i].b);
+	}
+
+	fflush(fp);
+	fclose(fp);
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include <opencv2/opencv.hpp>
+#include "opencv2/imgproc/types_c.h"
+#include "libobsensor/ObSensor.hpp"
+#include "utils.hpp"
+
+// Converted image together with the frame it was produced from
+typedef struct ImageSlot_S {
+	FrameSlot_S frame;		// Keeps the SDK buffer wrapped by raw alive
+	cv::Mat raw;			// Frame data without copy, used by frame capturing
+	cv::Mat image;			// RGB image ready for display
+} ImageSlot_S;
+
+typedef enum {
+	DEPTH_FILTER_NONE = 0,
+	DEPTH_FILTER_GAUSSIAN = 1,
+	DEPTH_FILTER_BLUR = 2,
+} DepthFilterType;
+
+typedef enum {
+	DEPTH_COLORMAP_JET = 0,
+	DEPTH_COLORMAP_TURBO = 1,
+	DEPTH_COLORMAP_GRAYSCALE = 2,		// Far is bright
+	DEPTH_COLORMAP_INVERSE = 3,			// Grayscale, near is bright
+	DEPTH_COLORMAP_WRAPPED = 4,			// Jet repeated every DEPTH_WRAP_MM from the range minimum
+	DEPTH_COLORMAP_COUNT
+} DepthColormapType;
+
+#define DEPTH_WRAP_MM 1000
+
+// How depth is shown: distances in dispRange (millimeter) spread over the colormap,
+// everything else including missing depth in invalidColor
+typedef struct DepthColorParam_S {
+	int dispRange[2] = { 0, 5000 };
+	DepthColormapType colormap = DEPTH_COLORMAP_JET;
+	cv::Vec3b invalidColor = cv::Vec3b(0, 0, 0);	// RGB
+} DepthColorParam_S;
+
+// Depth to RGB for every 16 bit value, rebuilt only when the parameters or the value scale change
+class DepthColorLut
+{
+public:
+	const cv::Vec3b* get(const DepthColorParam_S& param, float valueScale);
+
+private:
+	std::vector<cv::Vec3b> mTable;
+	DepthColorParam_S mParam;
+	float mValueScale = -1.0f;
+};
+
+// Per-frame conversion kernels. They only touch the given slot plus thread-local
+// scratch buffers, so different streams can be converted concurrently.
+// Color: MJPG, NV21, NV12, I420, YUYV/YUY2, UYVY, RGB888 and BGR, all to RGB.
+// reduction 2, 4 or 8 decodes MJPG at that fraction of the size, other formats ignore it
+void convertColorFrame(ImageSlot_S& slot, int reduction = 1);
+void convertDepthFrame(ImageSlot_S& slot, const DepthColorParam_S& param);
+// 16 bit depth to RGB through a table from DepthColorLut
+void colorizeDepth(const cv::Mat& depth, cv::Mat& image, const cv::Vec3b* table);
+const char* depthColormapName(DepthColormapType colormap);
+// 256 colors of a colormap from near to far, RGB order, 1 row
+cv::Mat depthColormapPalette(DepthColormapType colormap);
+// Sets only slot.raw and leaves slot.image empty, for the formats the display shaders decode:
+// Y16 depth, Y16/Y8 IR, YUYV/YUY2/UYVY color. Returns false for other formats.
+bool wrapRawFrame(ImageSlot_S& slot);
+void convertIRFrame(ImageSlot_S& slot);
+int yuvToRGBCode(OBFormat format);
+// Largest JPEG reduction that still covers the display size, 1 when no size is given
+int selectJpegReduction(int width, int height, int displayWidth, int displayHeight);
+void decodeJpeg(const cv::Mat& data, cv::Mat& image, int reduction);
+void applyDepthFilter(cv::Mat& image, DepthFilterType filter, int filterSize);
+// 8-bit gray or RGB image as an RGB image for glTexImage2D, shares the data when it already is RGB
+void convertTextureImage(const cv::Mat& source, cv::Mat& target);
+
+// Save point cloud data to ply
+void savePointsToPly(const OBColorPoint* points, size_t count, const std::string& fileName);
@@ -0,0 +1,119 @@
+#pragma once
+#include <atomic>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum {
+    FRAME_RING_LATEST_ONLY = 0,     // Consumer jumps to the newest entry, older ones are counted as skipped
+    FRAME_RING_KEEP_ALL = 1,        // Consumer receives every entry in arrival order
+} FrameRingPolicy;
+
+typedef struct FrameRingStats_S {
+    uint64_t pushed;
+    uint64_t popped;
+    uint64_t overflowDropped;       // Producer found the ring full and discarded the new entry
+    uint64_t skipped;               // Superseded by a newer entry under FRAME_RING_LATEST_ONLY
+} FrameRingStats_S;
+
+// Fixed-capacity lock-free ring for exactly one producer thread and one consumer thread.
+// One slot is kept empty to tell "full" from "empty", so the storage holds capacity + 1 entries.
+template <typename T>
+class FrameRing
+{
+public:
+    explicit FrameRing(size_t capacity = 4) { reset(capacity); }
+
+    // Not thread safe, call only while neither producer nor consumer is active
+    void reset(size_t capacity)
+    {
+        if (capacity < 1) capacity = 1;
+        m_slots.assign(capacity + 1, T());
+        m_head.store(0, std::memory_order_relaxed);
+        m_tail.store(0, std::memory_order_relaxed);
+        m_pushed.store(0, std::memory_order_relaxed);
+        m_popped.store(0, std::memory_order_relaxed);
+        m_overflowDropped.store(0, std::memory_order_relaxed);
+        m_skipped.store(0, std::memory_order_relaxed);
+    }
+
+    inline size_t capacity() const { return m_slots.size() - 1; }
+
+    // Producer side
+    bool push(const T& item)
+    {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        size_t next = (head + 1) % m_slots.size();
+        if (next == m_tail.load(std::memory_order_acquire)) {
+            m_overflowDropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        m_slots[head] = item;
+        m_head.store(next, std::memory_order_release);
+        m_pushed.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Consumer side, returns false when the ring is empty
+    bool pop(T& item, FrameRingPolicy policy)
+    {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        size_t head = m_head.load(std::memory_order_acquire);
+        if (tail == head) return false;
+
+        if (policy == FRAME_RING_LATEST_ONLY) {
+            // Release everything but the newest entry
+            size_t last = (head + m_slots.size() - 1) % m_slots.size();
+            while (tail != last) {
+                m_slots[tail] = T();
+                tail = (tail + 1) % m_slots.size();
+                m_skipped.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        item = m_slots[tail];
+        m_slots[tail] = T();
+        m_tail.store((tail + 1) % m_slots.size(), std::memory_order_release);
+        m_popped.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Consumer side, whether pop() would find nothing
+    inline bool empty() const
+    {
+        return m_tail.load(std::memory_order_relaxed) == m_head.load(std::memory_order_acquire);
+    }
+
+    // Consumer side, releases every queued entry; they are counted as skipped
+    void clear()
+    {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        size_t head = m_head.load(std::memory_order_acquire);
+        while (tail != head) {
+            m_slots[tail] = T();
+            tail = (tail + 1) % m_slots.size();
+            m_skipped.fetch_add(1, std::memory_order_relaxed);
+        }
+        m_tail.store(tail, std::memory_order_release);
+    }
+
+    FrameRingStats_S getStats() const
+    {
+        FrameRingStats_S stats;
+        stats.pushed = m_pushed.load(std::memory_order_relaxed);
+        stats.popped = m_popped.load(std::memory_order_relaxed);
+        stats.overflowDropped = m_overflowDropped.load(std::memory_order_relaxed);
+        stats.skipped = m_skipped.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+private:
+    std::vector<T> m_slots;
+    std::atomic<size_t> m_head{ 0 };    // Next slot to write, owned by the producer
+    std::atomic<size_t> m_tail{ 0 };    // Next slot to read, owned by the consumer
+
+    std::atomic<uint64_t> m_pushed{ 0 };
+    std::atomic<uint64_t> m_popped{ 0 };
+    std::atomic<uint64_t> m_overflowDropped{ 0 };
+    std::atomic<uint64_t> m_skipped{ 0 };
+};
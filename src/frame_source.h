@@ -0,0 +1,23 @@
+#pragma once
+#include "libobsensor/ObSensor.hpp"
+#include "utils.hpp"
+#include <functional>
+#include <string>
+
+// Produces the frames of the three streams in place of a device, see Sensors::initFrameSource().
+// Frames are handed over as FrameSlot_S so the conversions, capturing and stats run unchanged.
+class FrameSource
+{
+public:
+    // Called on the source's own threads, one frame at a time per stream
+    typedef std::function<void(StreamIndex stream, const FrameSlot_S& frame)> FrameHandler;
+
+    virtual ~FrameSource() {}
+
+    virtual std::string getName() = 0;
+    // Set before the first stream is enabled
+    virtual void setFrameHandler(FrameHandler handler) = 0;
+    // Start or stop delivering one stream; stopping waits until the handler is no longer running for it
+    virtual void setStreamEnabled(StreamIndex stream, bool state) = 0;
+    virtual FrameInfo_S getFrameInfo(StreamIndex stream) = 0;
+};
@@ -14,11 +14,15 @@
 #include "imgui/imgui_impl_opengl3.h"
 #include <stdio.h>
 #include <fstream>
+#include <future>
 #define GL_SILENCE_DEPRECATION
 #if defined(IMGUI_IMPL_OPENGL_ES2)
 #include <GLES2/gl2.h>
 #endif
 #include <GLFW/glfw3.h> // Will drag system OpenGL headers
+#include "render/stream_texture.h"
+#include "render/frame_shader.h"
+#include "render/point_cloud_renderer.h"
 
 // [Win32] Our example includes a copy of glfw3.lib pre-compiled with VS2010 to maximize ease of testing and compatibility with old VS compilers.
 // To link with VS2010-era libraries, VS2015+ requires linking with legacy_stdio_definitions.lib, which we do using this pragma.
@@ -38,34 +42,43 @@ static void glfw_error_callback(int error, const char* description)
     fprintf(stderr, "GLFW Error %d: %s\n", error, description);
 }
 
-// Convert OpenCV Mat to texture for rendering
-void mat2texture(cv::Mat* source, GLuint& target)
+// Newest image of a stream into its texture, through the shaders when the frame was left raw.
+// Returns the image size, 0 until the stream has an image.
+ImVec2 updateStreamTexture(Service* service, StreamIndex stream, StreamTexture& texture, FrameShader& frameShader)
 {
-    if (source->empty() || source == NULL || (const unsigned char*)source->data == NULL) return;
-    if (target != 0) glDeleteTextures(1, &target);
-
-    cv::Mat tmpMat;
-    if (source->channels() == 3)
-        tmpMat = *source;
-    else if (source->channels() == 1)
-        cv::cvtColor(*source, tmpMat, CV_GRAY2RGB);
-
-    unsigned char* image = tmpMat.data;
-
-    if (image == 0) return;
-    int w = tmpMat.cols;
-    int h = tmpMat.rows;
-
-    glGenTextures(1, &target);
-    glBindTexture(GL_TEXTURE_2D, target);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, w, h, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
-    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
-    glBindTexture(GL_TEXTURE_2D, 0);
-    tmpMat.release();
+    bool is_updated = false;
+    const ImageSlot_S* slot = service->getImageSlot(stream, &is_updated);
+    if (slot == nullptr) return ImVec2(0.0f, 0.0f);
+    // Upload only when a new image was converted
+    if (is_updated || texture.empty()) {
+        if (!slot->image.empty()) texture.update(slot->image);
+        else if (!frameShader.render(*slot, service->getDepthColorParam(), texture)) service->setRawPreview(false);
+    }
+    if (texture.empty()) return ImVec2(0.0f, 0.0f);
+    return ImVec2((float)texture.width(), (float)texture.height());
+}
+
+// Label next to a property slider, follows the queued device write
+const char* controlStatusLabel(ControlStatus status)
+{
+    switch (status) {
+    case CONTROL_PENDING:
+        return "Busy";
+    case CONTROL_FAILED:
+        return "Failed";
+    case CONTROL_UNSUPPORTED:
+        return "N/A";
+    default:
+        return "Adjust";
+    }
+}
+
+// Shown next to a switch while its write is queued or after it failed
+void controlStatusHint(ControlStatus status)
+{
+    if (status != CONTROL_PENDING && status != CONTROL_FAILED) return;
+    ImGui::SameLine();
+    ImGui::Text(controlStatusLabel(status));
 }
 
 void objectDisableBegin()
@@ -103,34 +116,55 @@ void setZRotation(int angle, int& target)
     if (angle != target) target = angle;
 }
 
-// Save point cloud data to ply
-void savePointsToPly(std::vector<OBColorPoint> points, std::string fileName) {
-    int   pointsSize = points.size();
-    FILE* fp = fopen(fileName.c_str(), "wb+");
-    fprintf(fp, "ply\n");
-    fprintf(fp, "format ascii 1.0\n");
-    fprintf(fp, "element vertex %d\n", pointsSize);
-    fprintf(fp, "property float x\n");
-    fprintf(fp, "property float y\n");
-    fprintf(fp, "property float z\n");
-    fprintf(fp, "property uchar red\n");
-    fprintf(fp, "property uchar green\n");
-    fprintf(fp, "property uchar blue\n");
-    fprintf(fp, "end_header\n");
-
-    for (int i = 0; i < pointsSize; i++) {
-        fprintf(fp, "%.3f %.3f %.3f %d %d %d\n", points[i].x, points[i].y, points[i].z, (int)points[i].r, (int)points[i].g, (int)points[i].b);
-    }
-
-    fflush(fp);
-    fclose(fp);
+// One connected device in the tiled view, tile 0 holds ob_service which the control panel operates on
+typedef struct DeviceTile_S {
+    std::string serialNum;
+    std::string name;
+    Service* service = nullptr;
+    std::future<Service*> opening;      // Opening and closing run off the UI thread
+    std::future<void> closing;
+    bool isOpen = false;
+    StreamTexture texture[3];
+    StreamCounters_S lastCounters[3];
+    // Per second rates summed over all streams
+    double fps = 0.0;
+    double mbps = 0.0;
+    uint64_t deviceDropped = 0;
+    uint64_t hostDropped = 0;
+} DeviceTile_S;
+
+// Milliseconds from process start to the first displayed frame of a stream
+double elapsedMs(const std::chrono::steady_clock::time_point& processStart)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - processStart).count();
 }
 
-bool g_isIRUnique = true;
+// Open an additional device on a worker thread; it streams color and depth for the tiled view
+Service* openDeviceService(std::string serialNum, std::shared_ptr<DeviceEnumerator> enumerator)
+{
+    // Device indices shift when cameras are plugged in or out, the serial number does not
+    std::vector<std::string> serialList = enumerator->getSerialList();
+    auto it = std::find(serialList.begin(), serialList.end(), serialNum);
+    if (it == serialList.end()) return nullptr;
+
+    int state = 0;
+    Service* service = new Service(state, (int)(it - serialList.begin()), enumerator);
+    if (state != 0) {
+        delete service;
+        return nullptr;
+    }
+    service->beginReconfiguration();
+    service->switchColorStream(true);
+    service->switchDepthStream(true);
+    service->commitReconfiguration();
+    return service;
+}
 
 // Main code
 int main(int, char**)
 {
+    // Start of the cold start to first frame measurement
+    const std::chrono::steady_clock::time_point process_start = std::chrono::steady_clock::now();
     glfwSetErrorCallback(glfw_error_callback);
     if (!glfwInit())
         return 1;
@@ -164,6 +198,7 @@ int main(int, char**)
     if (window == nullptr) return 1;
     glfwMakeContextCurrent(window);
     glfwSwapInterval(1); // Enable vsync
+    loadGLFunctions();
 
     // Setup Dear ImGui context
     IMGUI_CHECKVERSION();
@@ -214,15 +249,28 @@ int main(int, char**)
     int exposure[3]             = { 0, 0, 0 };
     PropertyInfo_S<int> gain_range[3];
     int gain[3]                 = { 0, 0, 0 };
+    bool is_exposure_stale[3]   = { 0, 0, 0 };  // re-read once auto exposure was switched off on the device
     bool auto_white_balance     = false;
     bool is_HW_D2C              = false;
     bool is_save_ply            = false;
     bool is_save_img            = false;
     bool is_export_cam_param    = false;
-    GLuint ob_disp_texture[3]   = { 0, 0, 0 };
-    cv::Mat* ob_disp_mat[3];
+    StreamTexture ob_disp_texture[3];
+    FrameShader frame_shader;
+    bool has_frame_shader       = frame_shader.init();
+    bool is_raw_preview         = false;
     std::string switch_label;
     int depth_disp_range[2]   = { 100, 5000 };
+    double first_frame_ms[3]    = { -1.0, -1.0, -1.0 };   // process start to the first image shown, per stream
+
+    // Multi-device
+    std::vector<DeviceTile_S> device_tiles;
+    bool is_tiled_view          = false;
+    int tiled_stream            = 1;    // 0: color, 1: depth
+    double stats_time           = 0.0;
+    bool is_auto_dump_stats     = false;
+    DeviceTile_S total_stats;
+    uint32_t device_generation  = 0;
 
     // Point Cloud
     int xRot = 0, yRot = 0, zRot = 0;
@@ -231,14 +279,42 @@ int main(int, char**)
     const double zoomScaleStep = 0.1;
     const float mouseRotateRatio = 1.0f;
     const double mouseTransRatio = 1000.0;
-    std::vector<OBColorPoint> cloud_points;
+    const PointCloudSlot_S* cloud = NULL;
     bool is_color = false;
+    PointCloudRenderer cloud_renderer;
+    cloud_renderer.init();
 
     // OpenCV
     bool is_gaussian_blur = false;
     bool is_blur = false;
     int filter_size[2] = { 5, 5 };
 
+#ifndef __EMSCRIPTEN__
+    // No camera connected yet, wait for the enumerator to report one instead of giving up
+    while (state == INIT_RESULT_NO_DEVICE && !glfwWindowShouldClose(window)) {
+        glfwPollEvents();
+        ImGui_ImplOpenGL3_NewFrame();
+        ImGui_ImplGlfw_NewFrame();
+        ImGui::NewFrame();
+        ImGui::SetNextWindowPos({ 0, 0 });
+        ImGui::SetNextWindowSize({ (float)window_width, icon_window_height });
+        ImGui::Begin("Icon Window", nullptr, flags_icon_window);
+        ImGui::Text("Waiting for device...");
+        ImGui::End();
+        ImGui::Render();
+        int display_w, display_h;
+        glfwGetFramebufferSize(window, &display_w, &display_h);
+        glViewport(0, 0, display_w, display_h);
+        glClearColor(clear_color.x * clear_color.w, clear_color.y * clear_color.w, clear_color.z * clear_color.w, clear_color.w);
+        glClear(GL_COLOR_BUFFER_BIT);
+        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        glfwSwapBuffers(window);
+
+        if (!ob_service->getSensorStrList()->empty()) state = ob_service->initCamera(0);
+    }
+#endif
+
+    OB_TRACE_THREAD("main");
     // Main loop
 #ifdef __EMSCRIPTEN__
     // For an Emscripten build we are disabling file-system access, so let's not attempt to do a fopen() of the imgui.ini file.
@@ -249,6 +325,7 @@ int main(int, char**)
     while (!glfwWindowShouldClose(window))
 #endif
     {
+        OB_TRACE_SCOPE("frame");
         glfwGetWindowSize(window, &window_width, &window_height);
         streaming_window.x = (float)window_width - ctrl_window_width;
         streaming_window.y = (float)window_height - icon_window_height;
@@ -266,24 +343,69 @@ int main(int, char**)
 
         int streaming_check = std::accumulate(is_streaming, is_streaming + 4, 0);
         if (!is_booting && streaming_check > 0) {
+            ob_service->readFrame();
             if (is_streaming[3]) {
-                cloud_points.clear();
-                ob_service->getPointCloudPoints(cloud_points, is_color);
+                bool is_cloud_updated = false;
+                cloud = ob_service->getPointCloud(is_color, &is_cloud_updated);
+                if (cloud != NULL && is_cloud_updated) cloud_renderer.update(cloud->points, cloud->count);
+            }
+        }
+        for (size_t i = 1; i < device_tiles.size(); i++) {
+            DeviceTile_S& tile = device_tiles[i];
+            if (tile.opening.valid() && tile.opening.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+                tile.service = tile.opening.get();
+                tile.isOpen = tile.service != nullptr;
+            }
+            if (tile.closing.valid() && tile.closing.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+                tile.closing.get();
+            }
+            if (tile.service != nullptr) tile.service->readFrame();
+        }
+        // Throughput over the last second; host drops are frames received but superseded before conversion
+        if (!is_booting && ImGui::GetTime() - stats_time >= 1.0) {
+            double elapsed = ImGui::GetTime() - stats_time;
+            stats_time = ImGui::GetTime();
+            if (is_auto_dump_stats) {
+                createSubDirectory("StreamStats");
+                ob_service->dumpStreamStats("StreamStats/stream_stats.json");
+            }
+            total_stats = DeviceTile_S();
+            for (size_t i = 0; i < device_tiles.size(); i++) {
+                DeviceTile_S& tile = device_tiles[i];
+                tile.fps = tile.mbps = 0.0;
+                tile.deviceDropped = tile.hostDropped = 0;
+                if (tile.service == nullptr) continue;
+                for (int n = 0; n < STREAM_COUNT; n++) {
+                    StreamCounters_S counters = tile.service->getStreamCounters((StreamIndex)n);
+                    StreamCounters_S& last = tile.lastCounters[n];
+                    tile.fps += (counters.received - last.received) / elapsed;
+                    tile.mbps += (counters.receivedBytes - last.receivedBytes) / elapsed / (1024.0 * 1024.0);
+                    tile.deviceDropped += counters.deviceDropped - last.deviceDropped;
+                    tile.hostDropped += (counters.received - counters.converted) - (last.received - last.converted);
+                    last = counters;
+                }
+                total_stats.fps += tile.fps;
+                total_stats.mbps += tile.mbps;
+                total_stats.deviceDropped += tile.deviceDropped;
+                total_stats.hostDropped += tile.hostDropped;
             }
-            else
-                ob_service->readFrame();
         }
         if (is_booting) {
             // Wait for GUi to be ready
-            ob_device = ob_service->getSensorStrList()->at(0);
+            ob_device = ob_service->getSensorStrList()->at(ob_service->getRecentDevice());
             ob_stream_res_vec[0] = ob_service->getSensorInfo(OBSensorType::OB_SENSOR_COLOR);
             ob_stream_res_vec[1] = ob_service->getSensorInfo(OBSensorType::OB_SENSOR_DEPTH);
             ob_stream_res_vec[2] = ob_service->getSensorInfo(OBSensorType::OB_SENSOR_IR);
 
-            // Make sure all stream modes are set to default mode
-            ob_service->setColorVideoMode(ob_current_mode[0]);
-            ob_service->setDepthVideoMode(ob_current_mode[1]);
-            ob_service->setIRVideoMode(ob_current_mode[2]);
+            // Start from the default profiles initCamera picked, a mode is only set when one is not in the list
+            ob_current_mode[0] = ob_service->getColorVideoMode();
+            ob_current_mode[1] = ob_service->getDepthVideoMode();
+            ob_current_mode[2] = ob_service->getIRVideoMode();
+            ob_service->beginReconfiguration();
+            if (ob_current_mode[0] < 0) { ob_current_mode[0] = 0; ob_service->setColorVideoMode(0); }
+            if (ob_current_mode[1] < 0) { ob_current_mode[1] = 0; ob_service->setDepthVideoMode(0); }
+            if (ob_current_mode[2] < 0) { ob_current_mode[2] = 0; ob_service->setIRVideoMode(0); }
+            ob_service->commitReconfiguration();
 
             is_mirror[0] = ob_service->getMirrorState(OBSensorType::OB_SENSOR_COLOR);
             is_mirror[1] = ob_service->getMirrorState(OBSensorType::OB_SENSOR_DEPTH);
@@ -313,8 +435,37 @@ int main(int, char**)
 
             ob_service->getDepthDispRange(depth_disp_range);
 
+            device_tiles.resize(1);
+            device_tiles[0].serialNum = ob_service->getSerialNum();
+            device_tiles[0].service = ob_service;
+            device_tiles[0].isOpen = true;
+
             is_booting = false;
         }
+        // Follow the enumerator's device list; open tiles of unplugged devices stay until they come back
+        if (!is_booting && ob_service->getDeviceEnumerator()->getGeneration() != device_generation) {
+            device_generation = ob_service->getDeviceEnumerator()->getGeneration();
+            std::vector<std::string> serial_list = ob_service->getDeviceEnumerator()->getSerialList();
+            std::vector<std::string> name_list = ob_service->getDeviceEnumerator()->getDeviceStrList();
+            std::vector<DeviceTile_S> tiles;
+            for (size_t i = 0; i < device_tiles.size(); i++) {
+                DeviceTile_S& tile = device_tiles[i];
+                bool is_connected = std::find(serial_list.begin(), serial_list.end(), tile.serialNum) != serial_list.end();
+                if (i == 0 || is_connected || tile.service != nullptr || tile.opening.valid() || tile.closing.valid()) {
+                    tiles.push_back(std::move(tile));
+                }
+            }
+            for (size_t i = 0; i < serial_list.size(); i++) {
+                auto it = std::find_if(tiles.begin(), tiles.end(), [&](const DeviceTile_S& tile) { return tile.serialNum == serial_list[i]; });
+                if (it == tiles.end()) {
+                    tiles.push_back(DeviceTile_S());
+                    it = tiles.end() - 1;
+                    it->serialNum = serial_list[i];
+                }
+                it->name = name_list[i];
+            }
+            device_tiles.swap(tiles);
+        }
         if (is_export_cam_param) {
             OBCameraParam camParams = ob_service->getCameraParams();
             string filename = "CameraParameters_";
@@ -362,6 +513,10 @@ int main(int, char**)
         ImGui::Begin("Icon Window", nullptr, flags_icon_window);
         // Display device information, the first one from getSensorStrList ONLY
         ImGui::Text(ob_device.c_str());
+        if (ob_service->isDeviceLost()) {
+            ImGui::SameLine();
+            ImGui::Text("(disconnected)");
+        }
         ImGui::SameLine(400.f);
 
         if (!is_streaming[3]) {
@@ -423,6 +578,8 @@ int main(int, char**)
         }
         if (ImGui::Button("Point Cloud", ImVec2(stream_btn_width, 0.f))) {
             is_streaming[3] = !is_streaming[3];
+            // Streams and alignment change together, restart the pipeline once
+            ob_service->beginReconfiguration();
             if (!is_streaming[0]) {
                 ob_service->switchColorStream(is_streaming[3]);
             }
@@ -433,6 +590,7 @@ int main(int, char**)
                 is_HW_D2C = !is_HW_D2C;
                 ob_service->toggleD2CAlignment(0);
             }
+            ob_service->commitReconfiguration();
             ob_service->togglePointCloud();
         }
         ImGui::PopStyleColor(2);
@@ -468,9 +626,11 @@ int main(int, char**)
                 ImGui::SameLine(ctrl_obj_spacing);
                 ImGui::Button(switch_label.c_str(), ImVec2({ ctrl_btn_width, 0.0f }));
                 if (ImGui::IsItemClicked(0)) {
+                    // Shown as set right away, the write itself is queued
+                    is_mirror[0] = !is_mirror[0];
                     ob_service->toggleMirror(OBSensorType::OB_SENSOR_COLOR);
-                    is_mirror[0] = ob_service->getMirrorState(OBSensorType::OB_SENSOR_COLOR);
                 }
+                controlStatusHint(ob_service->getControlStatus(OB_PROP_COLOR_MIRROR_BOOL));
                 ImGui::PopID();
 
                 // Toggle button for Color Flip
@@ -480,9 +640,10 @@ int main(int, char**)
                 ImGui::SameLine(ctrl_obj_spacing);
                 ImGui::Button(switch_label.c_str(), ImVec2({ ctrl_btn_width, 0.0f }));
                 if (ImGui::IsItemClicked(0)) {
+                    is_flip[0] = !is_flip[0];
                     ob_service->toggleFlip(OBSensorType::OB_SENSOR_COLOR);
-                    is_flip[0] = ob_service->getFlipState(OBSensorType::OB_SENSOR_COLOR);
                 }
+                controlStatusHint(ob_service->getControlStatus(OB_PROP_COLOR_FLIP_BOOL));
                 ImGui::PopID();
 
                 // Toggle button for Color Auto White Balance
@@ -495,6 +656,7 @@ int main(int, char**)
                     auto_white_balance = !auto_white_balance;
                     ob_service->toggleAutoWhiteBalance(auto_white_balance);
                 }
+                controlStatusHint(ob_service->getControlStatus(OB_PROP_COLOR_AUTO_WHITE_BALANCE_BOOL));
                 ImGui::PopID();
 
                 if (auto_exp[0].max > 0 && auto_exp[0].min > 0) {
@@ -507,22 +669,26 @@ int main(int, char**)
                     if (ImGui::IsItemClicked(0)) {
                         auto_exp[0].state = !auto_exp[0].state;
                         ob_service->toggleAutoExposure(auto_exp[0].state);
-                        auto_exp[0] = ob_service->getAutoExposureStatus(OBSensorType::OB_SENSOR_COLOR);
-                        if (!auto_exp[0].state) {
-                            exposure[0] = ob_service->getExposureValue();
-                            gain[0] = ob_service->getColorGainValue();
-                        }
+                        is_exposure_stale[0] = !auto_exp[0].state;
+                    }
+                    ControlStatus auto_exp_status = ob_service->getControlStatus(OB_PROP_COLOR_AUTO_EXPOSURE_BOOL);
+                    controlStatusHint(auto_exp_status);
+                    // Values auto exposure left behind, read once the device took the switch
+                    if (is_exposure_stale[0] && auto_exp_status != CONTROL_PENDING) {
+                        exposure[0] = ob_service->getExposureValue();
+                        gain[0] = ob_service->getColorGainValue();
+                        is_exposure_stale[0] = false;
                     }
                     // Adjust Exposure and Gain values is available when auto exposure is off
                     if (auto_exp[0].state) objectDisableBegin();
                     // Adjust Exposure value
                     ImGui::Text("Adjust Exposure");
                     ImGui::SliderInt("##ColorExpoValue", &exposure[0], auto_exp[0].min, auto_exp[0].max);
-                    if (ImGui::IsItemDeactivatedAfterEdit()) {
+                    if (ImGui::IsItemEdited()) {
                         ob_service->setExposureValue(exposure[0]);
                     }
                     ImGui::SameLine(ctrl_obj_spacing);
-                    ImGui::Text("Adjust");
+                    ImGui::Text(controlStatusLabel(ob_service->getControlStatus(OB_PROP_COLOR_EXPOSURE_INT)));
                     ImGui::PopID();
                 }
 
@@ -530,11 +696,11 @@ int main(int, char**)
                 ImGui::PushID("Color Gain");
                 ImGui::Text("Adjust Gain");
                 ImGui::SliderInt("##ColorGainValue", &gain[0], gain_range[0].min, gain_range[0].max);
-                if (ImGui::IsItemDeactivatedAfterEdit()) {
+                if (ImGui::IsItemEdited()) {
                     ob_service->setColorGainValue(gain[0]);
                 }
                 ImGui::SameLine(ctrl_obj_spacing);
-                ImGui::Text("Adjust");
+                ImGui::Text(controlStatusLabel(ob_service->getControlStatus(OB_PROP_COLOR_GAIN_INT)));
                 ImGui::PopID();
                 if (auto_exp[0].state) objectDisableEnd();
             }
@@ -563,9 +729,11 @@ int main(int, char**)
                 ImGui::SameLine(ctrl_obj_spacing);
                 ImGui::Button(switch_label.c_str(), ImVec2({ ctrl_btn_width, 0.0f }));
                 if (ImGui::IsItemClicked(0)) {
+                    // Shown as set right away, the write itself is queued
+                    is_mirror[1] = !is_mirror[1];
                     ob_service->toggleMirror(OBSensorType::OB_SENSOR_DEPTH);
-                    is_mirror[1] = ob_service->getMirrorState(OBSensorType::OB_SENSOR_DEPTH);
                 }
+                controlStatusHint(ob_service->getControlStatus(OB_PROP_DEPTH_MIRROR_BOOL));
                 ImGui::PopID();
 
                 // Toggle button for Depth Flip
@@ -575,9 +743,10 @@ int main(int, char**)
                 ImGui::SameLine(ctrl_obj_spacing);
                 ImGui::Button(switch_label.c_str(), ImVec2({ ctrl_btn_width, 0.0f }));
                 if (ImGui::IsItemClicked(0)) {
+                    is_flip[1] = !is_flip[1];
                     ob_service->toggleFlip(OBSensorType::OB_SENSOR_DEPTH);
-                    is_flip[1] = ob_service->getFlipState(OBSensorType::OB_SENSOR_DEPTH);
                 }
+                controlStatusHint(ob_service->getControlStatus(OB_PROP_DEPTH_FLIP_BOOL));
                 ImGui::PopID();
 
                 if (auto_exp[1].max > 0 && auto_exp[1].min > 0) {
@@ -590,11 +759,15 @@ int main(int, char**)
                     if (ImGui::IsItemClicked(0)) {
                         auto_exp[1].state = !auto_exp[1].state;
                         ob_service->toggleDepthAutoExposure(auto_exp[1].state);
-                        auto_exp[1] = ob_service->getAutoExposureStatus(OBSensorType::OB_SENSOR_DEPTH);
-                        if (!auto_exp[1].state) {
-                            exposure[1] = ob_service->getDepthExposureValue();
-                            gain[1] = ob_service->getDepthGainValue();
-                        }
+                        is_exposure_stale[1] = !auto_exp[1].state;
+                    }
+                    ControlStatus auto_exp_status = ob_service->getControlStatus(OB_PROP_DEPTH_AUTO_EXPOSURE_BOOL);
+                    controlStatusHint(auto_exp_status);
+                    // Values auto exposure left behind, read once the device took the switch
+                    if (is_exposure_stale[1] && auto_exp_status != CONTROL_PENDING) {
+                        exposure[1] = ob_service->getDepthExposureValue();
+                        gain[1] = ob_service->getDepthGainValue();
+                        is_exposure_stale[1] = false;
                     }
 
                     // Adjust Exposure and Gain values is available when auto exposure is off
@@ -602,22 +775,22 @@ int main(int, char**)
                     // Adjust Exposure value
                     ImGui::Text("Adjust Exposure");
                     ImGui::SliderInt("##DepthExpoValue", &exposure[1], auto_exp[1].min, auto_exp[1].max);
-                    if (ImGui::IsItemDeactivatedAfterEdit()) {
+                    if (ImGui::IsItemEdited()) {
                         ob_service->setDepthExposureValue(exposure[1]);
                     }
                     ImGui::SameLine(ctrl_obj_spacing);
-                    ImGui::Text("Adjust");
+                    ImGui::Text(controlStatusLabel(ob_service->getControlStatus(OB_PROP_DEPTH_EXPOSURE_INT)));
                     ImGui::PopID();
 
                     // Adjust Gain value
                     ImGui::PushID("Depth Gain");
                     ImGui::Text("Adjust Gain");
                     ImGui::SliderInt("##DepthGainValue", &gain[1], gain_range[1].min, gain_range[1].max);
-                    if (ImGui::IsItemDeactivatedAfterEdit()) {
+                    if (ImGui::IsItemEdited()) {
                         ob_service->setDepthGainValue(gain[1]);
                     }
                     ImGui::SameLine(ctrl_obj_spacing);
-                    ImGui::Text("Adjust");
+                    ImGui::Text(controlStatusLabel(ob_service->getControlStatus(OB_PROP_DEPTH_GAIN_INT)));
                     ImGui::PopID();
                     if (auto_exp[1].state) objectDisableEnd();
                 }
@@ -648,6 +821,27 @@ int main(int, char**)
                     ob_service->setDepthDispRange(depth_disp_range);
                 }
                 if (depth_disp_range[1] < depth_disp_range[0]) depth_disp_range[1] = depth_disp_range[0];
+
+                // Colormap and invalid color only rebuild the lookup table, not per frame
+                ImGui::Text("Colormap");
+                DepthColormapType depth_colormap = ob_service->getDepthColormap();
+                if (ImGui::BeginCombo("##DepthColormap", depthColormapName(depth_colormap))) {
+                    for (int n = 0; n < DEPTH_COLORMAP_COUNT; n++) {
+                        bool isSelected = (n == depth_colormap);
+                        if (ImGui::Selectable(depthColormapName((DepthColormapType)n), isSelected)) {
+                            ob_service->setDepthColormap((DepthColormapType)n);
+                        }
+                        if (isSelected) ImGui::SetItemDefaultFocus();
+                    }
+                    ImGui::EndCombo();
+                }
+                cv::Vec3b invalid_color = ob_service->getDepthInvalidColor();
+                float invalid_rgb[3] = { invalid_color[0] / 255.0f, invalid_color[1] / 255.0f, invalid_color[2] / 255.0f };
+                ImGui::Text("Invalid Pixels");
+                if (ImGui::ColorEdit3("##DepthInvalidColor", invalid_rgb, ImGuiColorEditFlags_NoInputs)) {
+                    ob_service->setDepthInvalidColor(cv::Vec3b((uint8_t)(invalid_rgb[0] * 255.0f + 0.5f), (uint8_t)(invalid_rgb[1] * 255.0f + 0.5f),
+                        (uint8_t)(invalid_rgb[2] * 255.0f + 0.5f)));
+                }
             }
             // IR
             if (ImGui::CollapsingHeader("IR")) {
@@ -674,9 +868,11 @@ int main(int, char**)
                 ImGui::SameLine(ctrl_obj_spacing);
                 ImGui::Button(switch_label.c_str(), ImVec2({ ctrl_btn_width, 0.0f }));
                 if (ImGui::IsItemClicked(0)) {
+                    // Shown as set right away, the write itself is queued
+                    is_mirror[2] = !is_mirror[2];
                     ob_service->toggleMirror(OBSensorType::OB_SENSOR_IR);
-                    is_mirror[2] = ob_service->getMirrorState(OBSensorType::OB_SENSOR_IR);
                 }
+                controlStatusHint(ob_service->getControlStatus(OB_PROP_IR_MIRROR_BOOL));
                 ImGui::PopID();
 
                 // Toggle button for IR Flip
@@ -686,9 +882,10 @@ int main(int, char**)
                 ImGui::SameLine(ctrl_obj_spacing);
                 ImGui::Button(switch_label.c_str(), ImVec2({ ctrl_btn_width, 0.0f }));
                 if (ImGui::IsItemClicked(0)) {
+                    is_flip[2] = !is_flip[2];
                     ob_service->toggleFlip(OBSensorType::OB_SENSOR_IR);
-                    is_flip[2] = ob_service->getFlipState(OBSensorType::OB_SENSOR_IR);
                 }
+                controlStatusHint(ob_service->getControlStatus(OB_PROP_IR_FLIP_BOOL));
                 ImGui::PopID();
 
                 if (auto_exp[2].max > 0 && auto_exp[2].min > 0) {
@@ -701,11 +898,15 @@ int main(int, char**)
                     if (ImGui::IsItemClicked(0)) {
                         auto_exp[2].state = !auto_exp[2].state;
                         ob_service->toggleIRAutoExposure(auto_exp[2].state);
-                        auto_exp[2] = ob_service->getAutoExposureStatus(OBSensorType::OB_SENSOR_IR);
-                        if (!auto_exp[2].state) {
-                            exposure[2] = ob_service->getIRExposureValue();
-                            gain[2] = ob_service->getDepthGainValue();
-                        }
+                        is_exposure_stale[2] = !auto_exp[2].state;
+                    }
+                    ControlStatus auto_exp_status = ob_service->getControlStatus(OB_PROP_IR_AUTO_EXPOSURE_BOOL);
+                    controlStatusHint(auto_exp_status);
+                    // Values auto exposure left behind, read once the device took the switch
+                    if (is_exposure_stale[2] && auto_exp_status != CONTROL_PENDING) {
+                        exposure[2] = ob_service->getIRExposureValue();
+                        gain[2] = ob_service->getDepthGainValue();
+                        is_exposure_stale[2] = false;
                     }
 
                     // Adjust Exposure and Gain values is available when auto exposure is off
@@ -713,22 +914,22 @@ int main(int, char**)
                     // Adjust Exposure value
                     ImGui::Text("Adjust Exposure");
                     ImGui::SliderInt("##IRExpoValue", &exposure[2], auto_exp[2].min, auto_exp[2].max);
-                    if (ImGui::IsItemDeactivatedAfterEdit()) {
+                    if (ImGui::IsItemEdited()) {
                         ob_service->setIRExposureValue(exposure[2]);
                     }
                     ImGui::SameLine(ctrl_obj_spacing);
-                    ImGui::Text("Adjust");
+                    ImGui::Text(controlStatusLabel(ob_service->getControlStatus(OB_PROP_IR_EXPOSURE_INT)));
                     ImGui::PopID();
 
                     // Adjust Gain value
                     ImGui::PushID("IR Gain");
                     ImGui::Text("Adjust Gain");
                     ImGui::SliderInt("##IRGainValue", &gain[2], gain_range[2].min, gain_range[2].max);
-                    if (ImGui::IsItemDeactivatedAfterEdit()) {
+                    if (ImGui::IsItemEdited()) {
                         ob_service->setDepthGainValue(gain[2]);
                     }
                     ImGui::SameLine(ctrl_obj_spacing);
-                    ImGui::Text("Adjust");
+                    ImGui::Text(controlStatusLabel(ob_service->getControlStatus(OB_PROP_DEPTH_GAIN_INT)));
                     ImGui::PopID();
                     if (auto_exp[2].state) objectDisableEnd();
                 }
@@ -767,12 +968,35 @@ int main(int, char**)
                         is_blur = !is_blur;
                     }
                     ImGui::PopID();
+
+                    // Filtering is part of the depth conversion, the frame is only re-filtered when settings change
+                    if (is_gaussian_blur)
+                        ob_service->setDepthFilter(DEPTH_FILTER_GAUSSIAN, filter_size[0]);
+                    else if (is_blur)
+                        ob_service->setDepthFilter(DEPTH_FILTER_BLUR, filter_size[1]);
+                    else
+                        ob_service->setDepthFilter(DEPTH_FILTER_NONE, filter_size[0]);
                 }
                 ImGui::Separator();
 
                 ImGui::Text("\nIR");
                 ImGui::SameLine(ctrl_obj_spacing);
                 ImGui::Text("TBD");
+                ImGui::Separator();
+
+                // Depth, IR and YUYV preview converted by shaders; needs OpenGL 3.0
+                is_raw_preview = ob_service->isRawPreview();
+                switch_label = is_raw_preview ? "ON" : "OFF";
+                ImGui::PushID("GPU Conversion");
+                ImGui::Text("GPU Conversion");
+                ImGui::SameLine(ctrl_obj_spacing);
+                if (!has_frame_shader) objectDisableBegin();
+                ImGui::Button(switch_label.c_str(), ImVec2({ ctrl_btn_width, 0.0f }));
+                if (ImGui::IsItemClicked(0) && has_frame_shader) {
+                    ob_service->setRawPreview(!is_raw_preview);
+                }
+                if (!has_frame_shader) objectDisableEnd();
+                ImGui::PopID();
             }
         }
         else {
@@ -842,6 +1066,112 @@ int main(int, char**)
                 is_export_cam_param = true;
             }
             ImGui::PopID();
+
+            // Frame acquisition mode, callback + keep-all delivers every frame to the capture path
+            static const char* acquisition_modes[] = { "Polling", "Callback (latest)", "Callback (keep all)" };
+            static int acquisition_mode = 0;
+            static int ring_depth = 4;
+            ImGui::PushID("Acquisition");
+            ImGui::Text("Acquisition Mode");
+            ImGui::Combo("##AcquisitionMode", &acquisition_mode, acquisition_modes, IM_ARRAYSIZE(acquisition_modes));
+            bool acquisition_changed = ImGui::IsItemDeactivatedAfterEdit();
+            ImGui::Text("Frame Ring Depth");
+            ImGui::SliderInt("##RingDepth", &ring_depth, 1, 64);
+            acquisition_changed |= ImGui::IsItemDeactivatedAfterEdit();
+            if (acquisition_changed) {
+                ob_service->setAcquisitionMode(acquisition_mode == 0 ? ACQUISITION_POLLING : ACQUISITION_CALLBACK, ring_depth,
+                    acquisition_mode == 2 ? FRAME_RING_KEEP_ALL : FRAME_RING_LATEST_ONLY);
+            }
+            if (ob_service->getAcquisitionMode() == ACQUISITION_CALLBACK) {
+                FrameRingStats_S ring_stats = ob_service->getFrameRingStats();
+                ImGui::Text("Pushed %llu / Popped %llu", (unsigned long long)ring_stats.pushed, (unsigned long long)ring_stats.popped);
+                ImGui::Text("Overflow %llu / Skipped %llu", (unsigned long long)ring_stats.overflowDropped, (unsigned long long)ring_stats.skipped);
+            }
+            ImGui::Text("Pipeline restarts %u, last %.1f ms", ob_service->getRestartCount(), ob_service->getLastRestartMs());
+            ImGui::Text("Property reads cached %llu / device %llu", (unsigned long long)ob_service->getPropertyCacheHits(), (unsigned long long)ob_service->getPropertyCacheMisses());
+            ImGui::Text("Device open %.1f ms", ob_service->getLastInitMs());
+            ImGui::Text("First frame C %.0f / D %.0f / IR %.0f ms", first_frame_ms[0], first_frame_ms[1], first_frame_ms[2]);
+            // Independent sensors, toggling a stream leaves the others running
+            static bool is_sensor_streaming = false;
+            if (ImGui::Checkbox("Per-Sensor Streaming", &is_sensor_streaming)) {
+                ob_service->setSensorStreaming(is_sensor_streaming);
+            }
+            if (is_sensor_streaming && !ob_service->isSensorDriven() && streaming_check > 0) {
+                ImGui::Text("Inactive while frame sync, D2C or the point cloud is on");
+            }
+#ifdef OB_TRACE_ENABLED
+            // Scoped markers of the last seconds of every thread, open the file in ui.perfetto.dev
+            static bool is_tracing = false;
+            if (ImGui::Checkbox("Record Trace", &is_tracing)) {
+                TraceRecorder::setRecording(is_tracing);
+            }
+            ImGui::SameLine(ctrl_obj_spacing);
+            if (ImGui::Button("Dump##Trace")) {
+                createSubDirectory("Traces");
+                TraceRecorder::dump("Traces/trace_" + getCurrentDateTime(true) + ".json");
+            }
+#endif
+            ImGui::PopID();
+        }
+        // Stream Stats
+        if (ImGui::CollapsingHeader("Stream Stats")) {
+            static const char* stream_names[STREAM_COUNT] = { "Color", "Depth", "IR" };
+            ImGui::PushID("Stream Stats");
+            for (int i = 0; i < STREAM_COUNT; i++) {
+                if (!is_streaming[i]) continue;
+                StreamStats_S stats = ob_service->getStreamStats((StreamIndex)i);
+                ImGui::Text("%s %.1f / %.0f fps (device %.1f)", stream_names[i], stats.fps, stats.nominalFps, stats.deviceFps);
+                ImGui::Text("  Gaps %llu / Host %llu / Ring %llu", (unsigned long long)stats.deviceDropped, (unsigned long long)stats.hostDropped, (unsigned long long)stats.ringDropped);
+                ImGui::Text("  Delivery p50 %.1f p99 %.1f max %.1f ms", stats.deliveryP50, stats.deliveryP99, stats.deliveryMax);
+                ImGui::Text("  Host p50 %.1f p99 %.1f max %.1f ms", stats.hostP50, stats.hostP99, stats.hostMax);
+            }
+            if (ImGui::Button("Dump")) {
+                createSubDirectory("StreamStats");
+                ob_service->dumpStreamStats("StreamStats/stream_stats_" + getCurrentDateTime(true) + ".json");
+            }
+            ImGui::SameLine();
+            // Rewrites StreamStats/stream_stats.json every second for monitoring scripts
+            ImGui::Checkbox("Auto Dump", &is_auto_dump_stats);
+            ImGui::PopID();
+        }
+        // Devices
+        if (ImGui::CollapsingHeader("Devices")) {
+            for (size_t i = 0; i < device_tiles.size(); i++) {
+                DeviceTile_S& tile = device_tiles[i];
+                ImGui::PushID((int)i);
+                // The first device is the one controlled by this panel and stays open
+                bool is_busy = i == 0 || tile.opening.valid() || tile.closing.valid();
+                if (is_busy) objectDisableBegin();
+                if (ImGui::Checkbox(tile.name.c_str(), &tile.isOpen)) {
+                    if (tile.isOpen) {
+                        tile.opening = std::async(std::launch::async, openDeviceService, tile.serialNum, ob_service->getDeviceEnumerator());
+                    }
+                    else {
+                        Service* service = tile.service;
+                        tile.service = nullptr;
+                        for (int n = 0; n < 3; n++) {
+                            tile.texture[n].release();
+                            tile.lastCounters[n] = StreamCounters_S();
+                        }
+                        tile.closing = std::async(std::launch::async, [service] { delete service; });
+                    }
+                }
+                if (is_busy) objectDisableEnd();
+                if (tile.service != nullptr && tile.service->isDeviceLost()) {
+                    ImGui::Text("Disconnected, waiting for the device");
+                }
+                else if (tile.service != nullptr) {
+                    ImGui::Text("%.1f fps  %.1f MB/s  drop %llu / %llu", tile.fps, tile.mbps,
+                        (unsigned long long)tile.deviceDropped, (unsigned long long)tile.hostDropped);
+                }
+                ImGui::PopID();
+            }
+            ImGui::Separator();
+            ImGui::Checkbox("Tiled View", &is_tiled_view);
+            static const char* tiled_streams[] = { "Color", "Depth" };
+            ImGui::Combo("##TiledStream", &tiled_stream, tiled_streams, IM_ARRAYSIZE(tiled_streams));
+            ImGui::Text("Total %.1f fps  %.1f MB/s", total_stats.fps, total_stats.mbps);
+            ImGui::Text("Dropped/s device %llu  host %llu", (unsigned long long)total_stats.deviceDropped, (unsigned long long)total_stats.hostDropped);
         }
         ImGui::End();
 
@@ -886,22 +1216,51 @@ int main(int, char**)
                 }
             }
         }
+        else if (is_tiled_view) {
+            // One tile per open device, laid out on a near square grid
+            std::vector<int> open_tiles;
+            for (size_t i = 0; i < device_tiles.size(); i++) {
+                if (device_tiles[i].service != nullptr) open_tiles.push_back((int)i);
+            }
+            int tile_cols = (int)ceil(sqrt((double)open_tiles.size()));
+            int tile_rows = tile_cols > 0 ? ((int)open_tiles.size() + tile_cols - 1) / tile_cols : 0;
+            for (size_t k = 0; k < open_tiles.size(); k++) {
+                DeviceTile_S& tile = device_tiles[open_tiles[k]];
+                ImVec2 tile_size(streaming_window.x / tile_cols, streaming_window.y / tile_rows);
+                ImGui::SetNextWindowPos({ ctrl_window_width + (k % tile_cols) * tile_size.x, icon_window_height + (k / tile_cols) * tile_size.y });
+                ImGui::SetNextWindowSize(tile_size);
+                std::string tile_title = "DeviceTile##" + std::to_string(open_tiles[k]);
+                ImGui::Begin(tile_title.c_str(), nullptr, flags_icon_window);
+                ImGui::Text("%s  %.1f fps%s", tile.name.c_str(), tile.fps, tile.service->isDeviceLost() ? "  (disconnected)" : "");
+                if (tiled_stream == 0) tile.service->setColorDisplaySize((int)ImGui::GetContentRegionAvail().x, (int)ImGui::GetContentRegionAvail().y);
+                ImVec2 tile_image = updateStreamTexture(tile.service, tiled_stream == 0 ? STREAM_COLOR : STREAM_DEPTH, tile.texture[tiled_stream], frame_shader);
+                if (tile_image.x > 0) {
+                    ImVec2 avail = ImGui::GetContentRegionAvail();
+                    float disp_ratio = std::min(avail.x / tile_image.x, avail.y / tile_image.y);
+                    ImGui::SetCursorPosX(ImGui::GetCursorPosX() + (avail.x - tile_image.x * disp_ratio) / 2);
+                    ImGui::Image((void*)(intptr_t)tile.texture[tiled_stream].id(), ImVec2(tile_image.x * disp_ratio, tile_image.y * disp_ratio));
+                }
+                ImGui::End();
+            }
+        }
         else {
             ImGui::SetNextWindowPos({ ctrl_window_width, icon_window_height });
             ImGui::SetNextWindowSize({ streaming_window.x / 2, streaming_window.y / 2 });
             ImGui::Begin("ColorStream", nullptr, flags_icon_window);
             if (is_streaming[0]) {
-                ob_disp_mat[0] = ob_service->getColorMat();
-                if (ob_disp_mat[0] != nullptr) {
-                    float disp_ratio = streaming_window.x / 2.06f / ob_disp_mat[0]->cols;
-                    float temp_ratio = streaming_window.y / 2.06f / ob_disp_mat[0]->rows;
-                    mat2texture(ob_disp_mat[0], ob_disp_texture[0]);
+                // MJPG is decoded only as large as the panel shows it
+                ob_service->setColorDisplaySize((int)(streaming_window.x / 2.06f), (int)(streaming_window.y / 2.06f));
+                ImVec2 disp_image = updateStreamTexture(ob_service, STREAM_COLOR, ob_disp_texture[0], frame_shader);
+                if (disp_image.x > 0) {
+                    float disp_ratio = streaming_window.x / 2.06f / disp_image.x;
+                    float temp_ratio = streaming_window.y / 2.06f / disp_image.y;
+                    if (first_frame_ms[0] < 0) first_frame_ms[0] = elapsedMs(process_start);
                     if (disp_ratio > temp_ratio) {
                         disp_ratio = temp_ratio;
-                        ImGui::SetCursorPosX(abs(streaming_window.x / 2 - ob_disp_mat[0]->cols * disp_ratio) / 2);
+                        ImGui::SetCursorPosX(abs(streaming_window.x / 2 - disp_image.x * disp_ratio) / 2);
                     }
-                    ImGui::SetCursorPosY(abs(streaming_window.y / 2 - ob_disp_mat[0]->rows * disp_ratio) / 2);
-                    ImGui::Image((void*)(intptr_t)ob_disp_texture[0], ImVec2(ob_disp_mat[0]->cols * disp_ratio, ob_disp_mat[0]->rows * disp_ratio));
+                    ImGui::SetCursorPosY(abs(streaming_window.y / 2 - disp_image.y * disp_ratio) / 2);
+                    ImGui::Image((void*)(intptr_t)ob_disp_texture[0].id(), ImVec2(disp_image.x * disp_ratio, disp_image.y * disp_ratio));
                 }
             }
             ImGui::End();
@@ -910,24 +1269,17 @@ int main(int, char**)
             ImGui::SetNextWindowSize({ streaming_window.x / 2, streaming_window.y / 2 });
             ImGui::Begin("DepthStream", nullptr, flags_icon_window);
             if (is_streaming[1]) {
-                ob_disp_mat[1] = ob_service->getDepthMat();
-                if (ob_disp_mat[1] != nullptr) {
-                    float disp_ratio = streaming_window.x / 2.06f / ob_disp_mat[1]->cols;
-                    float temp_ratio = streaming_window.y / 2.06f / ob_disp_mat[1]->rows;
-                    cv::Mat disp_mat = ob_disp_mat[1]->clone();
-                    if (is_gaussian_blur) {
-                        cv::GaussianBlur(disp_mat, disp_mat, cv::Size(filter_size[0], filter_size[0]), 0, 0);
-                    }
-                    else if (is_blur) {
-                        cv::blur(disp_mat, disp_mat, cv::Size(filter_size[1], filter_size[1]));
-                    }
-                    mat2texture(&disp_mat, ob_disp_texture[1]);
+                ImVec2 disp_image = updateStreamTexture(ob_service, STREAM_DEPTH, ob_disp_texture[1], frame_shader);
+                if (disp_image.x > 0) {
+                    float disp_ratio = streaming_window.x / 2.06f / disp_image.x;
+                    float temp_ratio = streaming_window.y / 2.06f / disp_image.y;
+                    if (first_frame_ms[1] < 0) first_frame_ms[1] = elapsedMs(process_start);
                     if (disp_ratio > temp_ratio) {
                         disp_ratio = temp_ratio;
-                        ImGui::SetCursorPosX(abs(streaming_window.x / 2 - disp_mat.cols * disp_ratio) / 2);
+                        ImGui::SetCursorPosX(abs(streaming_window.x / 2 - disp_image.x * disp_ratio) / 2);
                     }
-                    ImGui::SetCursorPosY(abs(streaming_window.y / 2 - disp_mat.rows * disp_ratio) / 2);
-                    ImGui::Image((void*)(intptr_t)ob_disp_texture[1], ImVec2(disp_mat.cols * disp_ratio, disp_mat.rows * disp_ratio));
+                    ImGui::SetCursorPosY(abs(streaming_window.y / 2 - disp_image.y * disp_ratio) / 2);
+                    ImGui::Image((void*)(intptr_t)ob_disp_texture[1].id(), ImVec2(disp_image.x * disp_ratio, disp_image.y * disp_ratio));
                 }
             }
             ImGui::End();
@@ -936,17 +1288,17 @@ int main(int, char**)
             ImGui::SetNextWindowSize({ streaming_window.x / 2, streaming_window.y / 2 });
             ImGui::Begin("IRStream", nullptr, flags_icon_window);
             if (is_streaming[2]) {
-                ob_disp_mat[2] = ob_service->getIRMat();
-                if (ob_disp_mat[2] != nullptr) {
-                    float disp_ratio = streaming_window.x / 2.06f / ob_disp_mat[2]->cols;
-                    float temp_ratio = streaming_window.y / 2.06f / ob_disp_mat[2]->rows;
-                    mat2texture(ob_disp_mat[2], ob_disp_texture[2]);
+                ImVec2 disp_image = updateStreamTexture(ob_service, STREAM_IR, ob_disp_texture[2], frame_shader);
+                if (disp_image.x > 0) {
+                    float disp_ratio = streaming_window.x / 2.06f / disp_image.x;
+                    float temp_ratio = streaming_window.y / 2.06f / disp_image.y;
+                    if (first_frame_ms[2] < 0) first_frame_ms[2] = elapsedMs(process_start);
                     if (disp_ratio > temp_ratio) {
                         disp_ratio = temp_ratio;
-                        ImGui::SetCursorPosX(abs(streaming_window.x / 2 - ob_disp_mat[2]->cols * disp_ratio) / 2);
+                        ImGui::SetCursorPosX(abs(streaming_window.x / 2 - disp_image.x * disp_ratio) / 2);
                     }
-                    ImGui::SetCursorPosY(abs(streaming_window.y / 2 - ob_disp_mat[2]->rows * disp_ratio) / 2);
-                    ImGui::Image((void*)(intptr_t)ob_disp_texture[2], ImVec2(ob_disp_mat[2]->cols * disp_ratio, ob_disp_mat[2]->rows * disp_ratio));
+                    ImGui::SetCursorPosY(abs(streaming_window.y / 2 - disp_image.y * disp_ratio) / 2);
+                    ImGui::Image((void*)(intptr_t)ob_disp_texture[2].id(), ImVec2(disp_image.x * disp_ratio, disp_image.y * disp_ratio));
                 }
             }
             ImGui::End();
@@ -959,7 +1311,10 @@ int main(int, char**)
         }
 
         // Rendering
-        ImGui::Render();
+        {
+            OB_TRACE_SCOPE("ImGui::Render");
+            ImGui::Render();
+        }
         int display_w, display_h;
         glfwGetFramebufferSize(window, &display_w, &display_h);
         glClearColor(clear_color.x * clear_color.w, clear_color.y * clear_color.w, clear_color.z * clear_color.w, clear_color.w);
@@ -974,9 +1329,9 @@ int main(int, char**)
             glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
             glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
             glMatrixMode(GL_PROJECTION);
-            if (!cloud_points.empty()) {
+            if (cloud != NULL) {
                 if (is_save_ply) {
-                    savePointsToPly(cloud_points, "./pointcloud.ply");
+                    savePointsToPly(cloud->points, cloud->count, "./pointcloud.ply");
                     is_save_ply = false;
                 }
                 glLoadIdentity();
@@ -992,12 +1347,18 @@ int main(int, char**)
                 glRotatef(zRot / 16.0, 0.0, 0.0, 1.0);
 
                 glPointSize(0.1f);
-                glBegin(GL_POINTS);
-                for (unsigned int i = 0; i < cloud_points.size(); i++) {
-                    glColor3ub(cloud_points.at(i).r, cloud_points.at(i).g, cloud_points.at(i).b);
-                    glVertex3f(cloud_points.at(i).x / 1000.0f, -cloud_points.at(i).y / 1000.0f, cloud_points.at(i).z / 1000.0f);
+                if (cloud_renderer.isReady()) {
+                    cloud_renderer.draw();
+                }
+                else {
+                    glBegin(GL_POINTS);
+                    for (size_t i = 0; i < cloud->count; i++) {
+                        const OBColorPoint& point = cloud->points[i];
+                        glColor3ub(point.r, point.g, point.b);
+                        glVertex3f(point.x / 1000.0f, -point.y / 1000.0f, point.z / 1000.0f);
+                    }
+                    glEnd();
                 }
-                glEnd();
 
                 glLineWidth(2.0);
                 glBegin(GL_LINES);
@@ -1035,17 +1396,35 @@ int main(int, char**)
         }
 
         glViewport(0, 0, display_w, display_h);
-        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        {
+            OB_TRACE_SCOPE("RenderDrawData");
+            ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        }
         glfwMakeContextCurrent(window);
-        glfwSwapBuffers(window);
+        {
+            OB_TRACE_SCOPE("glfwSwapBuffers");
+            glfwSwapBuffers(window);
+        }
     }
 #ifdef __EMSCRIPTEN__
     EMSCRIPTEN_MAINLOOP_END;
 #endif
 
+    for (size_t i = 1; i < device_tiles.size(); i++) {
+        DeviceTile_S& tile = device_tiles[i];
+        if (tile.opening.valid()) tile.service = tile.opening.get();
+        if (tile.closing.valid()) tile.closing.get();
+        if (tile.service != nullptr) delete tile.service;
+    }
     if (ob_service != nullptr) delete ob_service;
 
     // Cleanup
+    for (size_t i = 0; i < device_tiles.size(); i++) {
+        for (int n = 0; n < 3; n++) device_tiles[i].texture[n].release();
+    }
+    for (int n = 0; n < 3; n++) ob_disp_texture[n].release();
+    frame_shader.release();
+    cloud_renderer.release();
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
@@ -1,42 +1,86 @@
 #include "orbbec_sensors.h"
 
-Sensors::Sensors()
+Sensors::Sensors(std::shared_ptr<DeviceEnumerator> enumerator) :
+    m_enumerator(enumerator)
 {
-    try {
-        // Query all connected device list
-        m_deviceList = m_context->queryDeviceList();
-
-        if (m_deviceStringList.size() == 0) {
-            int devCount = m_deviceList->deviceCount();
-            for (int i = 0; i < devCount; i++) {
-                auto device = m_deviceList->getDevice(i);
-                auto deviceInfo = device->getDeviceInfo();
-
-                std::string deviceName = deviceInfo->name();
-                deviceName.append(" #SN:").append(deviceInfo->serialNumber()).append(" USB:").append(deviceInfo->usbType());
-                m_deviceStringList.push_back(deviceName);
-                device.reset();
-            }
-        }
-    }
-    catch (ob::Error& e) {
-        std::cerr << "function:" << e.getName() << "\nargs:" << e.getArgs() << "\nmessage:" << e.getMessage() << "\ntype:" << e.getExceptionType() << std::endl;
-        exit(EXIT_FAILURE);
+    for (int i = 0; i < STREAM_COUNT; i++) {
+        m_receivedFrames[i] = 0;
+        m_receivedBytes[i] = 0;
+        m_droppedFrames[i] = 0;
     }
+
+    // The cache takes the value just written; auto exposure and white balance also move the manual values,
+    // which are read again. A failed write left the device, and so the cached value, as it was
+    m_controlQueue.setCompletionCallback([this](OBPropertyID id, int value, ControlStatus status) {
+        if (status != CONTROL_DONE) return;
+        m_propertyCache.store(id, value);
+        if (id == OB_PROP_COLOR_AUTO_EXPOSURE_BOOL) {
+            m_propertyCache.invalidate(OB_PROP_COLOR_EXPOSURE_INT);
+            m_propertyCache.invalidate(OB_PROP_COLOR_GAIN_INT);
+        }
+        else if (id == OB_PROP_DEPTH_AUTO_EXPOSURE_BOOL) {
+            m_propertyCache.invalidate(OB_PROP_DEPTH_EXPOSURE_INT);
+            m_propertyCache.invalidate(OB_PROP_DEPTH_GAIN_INT);
+        }
+        else if (id == OB_PROP_IR_AUTO_EXPOSURE_BOOL) {
+            m_propertyCache.invalidate(OB_PROP_IR_EXPOSURE_INT);
+            m_propertyCache.invalidate(OB_PROP_IR_GAIN_INT);
+        }
+        else if (id == OB_PROP_COLOR_AUTO_WHITE_BALANCE_BOOL) {
+            m_propertyCache.invalidate(OB_PROP_COLOR_WHITE_BALANCE_INT);
+        }
+        else if (id == OB_PROP_DEPTH_PRECISION_LEVEL_INT) {
+            m_depthValueScale = OBDepthPrecisionLevelToFloat((OBDepthPrecisionLevel)value);
+        }
+    });
+
+    if (m_enumerator == nullptr) m_enumerator = std::make_shared<DeviceEnumerator>();
+    m_deviceListenerId = m_enumerator->addDeviceChangedListener([this](const std::vector<std::string>& removed, const std::vector<std::string>& added) {
+        onDeviceChanged(removed, added);
+    });
 }
 
 Sensors::~Sensors()
 {
+    // Waits for a running reconnect before tearing down
+    m_enumerator->removeDeviceChangedListener(m_deviceListenerId);
     deinitCurSensor();
+    stopPointCloud();
+}
+
+// The preferred profile, or the first one when the device has none matching
+static std::shared_ptr<ob::VideoStreamProfile> selectVideoProfile(const std::shared_ptr<ob::StreamProfileList>& profileList, int width, int height, OBFormat format, int fps)
+{
+    try {
+        return profileList->getVideoStreamProfile(width, height, format, fps);
+    }
+    catch (ob::Error& e) {
+        // Open default Profile if cannot find the corresponding format
+        return std::const_pointer_cast<ob::StreamProfile>(profileList->getProfile(0))->as<ob::VideoStreamProfile>();
+    }
 }
 
 int Sensors::initCurSensor(const int deviceIndex)
 {
+    // The acquisition thread must not touch the pipeline while it is being replaced
+    stopAcquisition();
+    // Nor the enumerator thread reconnecting a lost device
+    std::lock_guard<std::mutex> lock(m_pipelineMutex);
+    stopSensorStreams();
+    // The previous pipeline, if any, is not handed to the new acquisition thread
+    setPipelineStarted(false);
+
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
     try {
         ob::Context::setLoggerSeverity(OB_LOG_SEVERITY_INFO);
 
         // Obtain device and create pipeline
-        m_device = m_deviceList->getDevice(deviceIndex);
+        std::shared_ptr<ob::DeviceList> deviceList = m_enumerator->getDeviceList();
+        if (deviceList == nullptr) return -1;
+        m_device = deviceList->getDevice(deviceIndex);
+        m_serialNum = m_device->getDeviceInfo()->serialNumber();
+        m_bIsDeviceLost = false;
+        m_controlQueue.setDevice(m_device);
         m_pipeline = std::make_shared<ob::Pipeline>(m_device);
         // Configure which streams to enable or disable for the Pipeline by creating a Config
         m_config = std::make_shared<ob::Config>();
@@ -60,31 +104,22 @@ int Sensors::initCurSensor(const int deviceIndex)
                 std::cerr << "function:" << e.getName() << "\nargs:" << e.getArgs() << "\nmessage:" << e.getMessage() << "\ntype:" << e.getExceptionType() << std::endl;
             }
         }
+        // Values are read in one sweep on the control thread, after the work mode is settled
+        m_propertyCache.reset(m_device, getPropertyList(m_device));
+        sweepProperties();
+        if (m_propertyCache.isPropertySupported(OB_PROP_DEPTH_PRECISION_LEVEL_INT, OB_PERMISSION_READ)) {
+            m_depthValueScale = OBDepthPrecisionLevelToFloat((OBDepthPrecisionLevel)m_propertyCache.getIntProperty(OB_PROP_DEPTH_PRECISION_LEVEL_INT));
+        }
         
         // Obtain all Stream Profiles for Color camera, including resolution, frame rate, and format
         m_colorStreamProfileList = m_pipeline->getStreamProfileList(OB_SENSOR_COLOR);
-        m_colorStreamProfile = nullptr;
-        try {
-            // According to the desired configurations to find the corresponding Profile, preference to RGB888 format
-            m_colorStreamProfile = m_colorStreamProfileList->getVideoStreamProfile(DEFAULT_WIDTH, DEFAULT_HEIGHT, OB_FORMAT_RGB888, 30);
-        }
-        catch (ob::Error& e) {
-            // Open default Profile if cannot find the corresponding format
-            m_colorStreamProfile = std::const_pointer_cast<ob::StreamProfile>(m_colorStreamProfileList->getProfile(0))->as<ob::VideoStreamProfile>();
-        }
-
+        // According to the desired configurations to find the corresponding Profile, preference to RGB888 format
+        m_colorStreamProfile = selectVideoProfile(m_colorStreamProfileList, DEFAULT_WIDTH, DEFAULT_HEIGHT, OB_FORMAT_RGB888, 30);
 
         // Obtain all Stream Profiles for Depth camera, including resolution, frame rate, and format
         m_depthStreamProfileList = m_pipeline->getStreamProfileList(OB_SENSOR_DEPTH);
-        m_depthStreamProfile = nullptr;
-        try {
-            // According to the desired configurations to find the corresponding Profile, preference to Y16 format
-            m_depthStreamProfile = m_depthStreamProfileList->getVideoStreamProfile(DEFAULT_WIDTH, 0, OB_FORMAT_Y16, 30);
-        }
-        catch (ob::Error& e) {
-            // Open default Profile if cannot find the corresponding format
-            m_depthStreamProfile = std::const_pointer_cast<ob::StreamProfile>(m_depthStreamProfileList->getProfile(0))->as<ob::VideoStreamProfile>();
-        }
+        // According to the desired configurations to find the corresponding Profile, preference to Y16 format
+        m_depthStreamProfile = selectVideoProfile(m_depthStreamProfileList, DEFAULT_WIDTH, 0, OB_FORMAT_Y16, 30);
 
         // Try find supported depth to color align hardware mode profile
         m_depthStreamProfileList = m_pipeline->getD2CDepthProfileList(m_colorStreamProfile, ALIGN_D2C_HW_MODE);
@@ -102,43 +137,25 @@ int Sensors::initCurSensor(const int deviceIndex)
         // Obtain all Stream Profiles for IR camera, including resolution, frame rate, and format
         try {
             m_irStreamProfileList = m_pipeline->getStreamProfileList(OB_SENSOR_IR);
-            m_irStreamProfile = nullptr;
-            try {
-                // According to the desired configurations to find the corresponding Profile, preference to Y16 format
-                m_irStreamProfile = m_irStreamProfileList->getVideoStreamProfile(DEFAULT_WIDTH, DEFAULT_HEIGHT, OB_FORMAT_Y16, 30);
-            }
-            catch (ob::Error& e) {
-                // Open default Profile if cannot find the corresponding format
-                m_irStreamProfile = std::const_pointer_cast<ob::StreamProfile>(m_irStreamProfileList->getProfile(0))->as<ob::VideoStreamProfile>();
-            }
         }
         catch (ob::Error& e) {
-            g_isIRUnique = false;
+            // Dual IR devices have no single IR sensor
+            m_irStreamProfileList = nullptr;
+        }
+        m_bIsIRUnique = m_irStreamProfileList != nullptr;
+        if (!m_bIsIRUnique) {
             // Dual IR, open with IR Left in default
             m_irStreamProfileList = m_pipeline->getStreamProfileList(OB_SENSOR_IR_LEFT);
-            m_irStreamProfile = nullptr;
-            try {
-                // According to the desired configurations to find the corresponding Profile, preference to Y16 format
-                m_irStreamProfile = m_irStreamProfileList->getVideoStreamProfile(DEFAULT_WIDTH, DEFAULT_HEIGHT, OB_FORMAT_Y16, 30);
-            }
-            catch (ob::Error& e) {
-                // Open default Profile if cannot find the corresponding format
-                m_irStreamProfile = std::const_pointer_cast<ob::StreamProfile>(m_irStreamProfileList->getProfile(0))->as<ob::VideoStreamProfile>();
-            }
         }
+        // According to the desired configurations to find the corresponding Profile, preference to Y16 format
+        m_irStreamProfile = selectVideoProfile(m_irStreamProfileList, DEFAULT_WIDTH, DEFAULT_HEIGHT, OB_FORMAT_Y16, 30);
 
-        // TO OBTAIN A DEFAULT CAMERA PARAMETER
-        try {
-            m_config->enableStream(m_depthStreamProfile);
-            m_pipeline->start(m_config);
-            m_curCameraParams = m_pipeline->getCameraParam();
-            m_pipeline->stop();
-            m_config->disableStream(OB_STREAM_DEPTH);
-        }
-        catch (ob::Error& e) {
-            std::cerr << "startCurDepth: " << e.getName() << "\nargs:" << e.getArgs() << "\nmessage:" << e.getMessage() << "\ntype:" << e.getExceptionType() << std::endl;
-        }
+        // Camera parameters are read when first asked for, starting the pipeline only for them costs a stream start and stop
+        m_bIsCameraParamValid = false;
+
+        m_lastInitMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
 
+        startAcquisition();
         return 0;
     }
     catch (ob::Error& e) {
@@ -147,28 +164,57 @@ int Sensors::initCurSensor(const int deviceIndex)
     }
 }
 
+int Sensors::initFrameSource(std::shared_ptr<FrameSource> source)
+{
+    stopAcquisition();
+    std::lock_guard<std::mutex> lock(m_pipelineMutex);
+    stopSensorStreams();
+    setPipelineStarted(false);
+
+    m_frameSource = source;
+    m_frameSource->setFrameHandler([this](StreamIndex stream, const FrameSlot_S& frame) {
+        publishSlot(stream, frame);
+    });
+    m_serialNum.clear();
+    startAcquisition();
+    return 0;
+}
+
 void Sensors::deinitCurSensor()
 {
+    stopAcquisition();
+    std::lock_guard<std::mutex> lock(m_pipelineMutex);
+
+    if (m_frameSource != nullptr) {
+        m_bIsColorOn = m_bIsDepthOn = m_bIsIROn = false;
+        for (int i = 0; i < STREAM_COUNT; i++) {
+            m_frameSource->setStreamEnabled((StreamIndex)i, false);
+            clearFrame((StreamIndex)i);
+        }
+        m_frameSource.reset();
+    }
+
     if (m_device) {
         try {
-            if (m_curColorFrame) {
+            stopSensorStreams();
+            if (m_bIsColorOn) {
                 printf("Destroy current color frame.\n");
                 m_bIsColorOn = false;
-                m_curColorFrame.reset();
+                clearFrame(STREAM_COLOR);
             }
-            if (m_curDepthFrame) {
+            if (m_bIsDepthOn) {
                 printf("Destroy current depth frame.\n");
                 m_bIsDepthOn = false;
-                m_curDepthFrame.reset();
+                clearFrame(STREAM_DEPTH);
             }
-            if (m_curIRFrame) {
+            if (m_bIsIROn) {
                 printf("Destroy current IR frame.\n");
                 m_bIsIROn = false;
-                m_curIRFrame.reset();
+                clearFrame(STREAM_IR);
             }
 
             // Stop current Pipeline and won't generate further frame data
-            m_pipeline->stop();
+            stopPipeline();
             printf("Orbbec Pipeline stopped.\n");
         }
         catch (ob::Error& e) {
@@ -177,6 +223,14 @@ void Sensors::deinitCurSensor()
     }
 }
 
+// Fill the property cache on the control thread, reads from the UI wait for it instead of going to the device
+void Sensors::sweepProperties()
+{
+    m_controlQueue.post([this](std::shared_ptr<ob::Device> device) {
+        m_propertyCache.sweep(device);
+    }, "Property sweep");
+}
+
 // Obtain Property list
 std::vector<OBPropertyItem> Sensors::getPropertyList(std::shared_ptr<ob::Device> device) {
     std::vector<OBPropertyItem> propertyVec;
@@ -191,23 +245,50 @@ std::vector<OBPropertyItem> Sensors::getPropertyList(std::shared_ptr<ob::Device>
     return propertyVec;
 }
 
+// The enumerator thread replaces m_device on a reconnect, UI side callers work on a copy
+std::shared_ptr<ob::Device> Sensors::getDevice()
+{
+    std::lock_guard<std::mutex> lock(m_pipelineMutex);
+    return m_device;
+}
+
 void Sensors::getCurSensorInfo(SensorInfo_S& sensorInfo)
 {
-    sensorInfo.deviceInfo = m_device->getDeviceInfo();
-    sensorInfo.vid = sensorInfo.deviceInfo->vid();
-    sensorInfo.pid = sensorInfo.deviceInfo->pid();
-    strcpy(sensorInfo.serialNum, sensorInfo.deviceInfo->serialNumber());
-    strcpy(sensorInfo.deviceName, sensorInfo.deviceInfo->name());
+    std::shared_ptr<ob::Device> device = getDevice();
+    if (!device) return;
+    try {
+        sensorInfo.deviceInfo = device->getDeviceInfo();
+        sensorInfo.vid = sensorInfo.deviceInfo->vid();
+        sensorInfo.pid = sensorInfo.deviceInfo->pid();
+        strcpy(sensorInfo.serialNum, sensorInfo.deviceInfo->serialNumber());
+        strcpy(sensorInfo.deviceName, sensorInfo.deviceInfo->name());
+    }
+    catch (ob::Error& e) {
+        std::cerr << "getCurSensorInfo: " << e.getName() << "\nargs:" << e.getArgs() << "\nmessage:" << e.getMessage() << "\ntype:" << e.getExceptionType() << std::endl;
+    }
 }
 
 std::vector<std::string>* Sensors::getSensorStrList()
 {
+    uint32_t generation = m_enumerator->getGeneration();
+    if (generation != m_deviceListGeneration) {
+        m_deviceStringList = m_enumerator->getDeviceStrList();
+        m_deviceListGeneration = generation;
+    }
     return &m_deviceStringList;
 }
 
 std::string Sensors::getFirmwareVer()
 {
-    return std::string(m_device->getDeviceInfo()->firmwareVersion());
+    std::shared_ptr<ob::Device> device = getDevice();
+    if (!device) return std::string();
+    try {
+        return std::string(device->getDeviceInfo()->firmwareVersion());
+    }
+    catch (ob::Error& e) {
+        std::cerr << "getFirmwareVer: " << e.getName() << "\nargs:" << e.getArgs() << "\nmessage:" << e.getMessage() << "\ntype:" << e.getExceptionType() << std::endl;
+        return std::string();
+    }
 }
 
 std::string Sensors::getSDKVer()
@@ -225,9 +306,9 @@ std::string Sensors::getSDKVer()
 
 bool Sensors::toggleD2CAlignment(int type)
 {
+    std::lock_guard<std::mutex> lock(m_pipelineMutex);
     m_bIsD2CAlignmentOn = !m_bIsD2CAlignmentOn;
     try {
-        m_pipeline->stop();  // gotta check if its necessary
         if (m_bIsD2CAlignmentOn) {
             if (type == 0)
                 m_config->setAlignMode(m_bIsSWD2C ? ALIGN_D2C_SW_MODE : ALIGN_D2C_HW_MODE);
@@ -236,7 +317,7 @@ bool Sensors::toggleD2CAlignment(int type)
         }
         else
             m_config->setAlignMode(ALIGN_DISABLE);
-        m_pipeline->start(m_config);
+        restartPipeline();
     }
     catch (std::exception& e) {
         std::cout << "[ERR] D2C Alignment property not support" << std::endl;
@@ -247,12 +328,15 @@ bool Sensors::toggleD2CAlignment(int type)
 
 bool Sensors::toggleFrameSync()
 {
+    std::lock_guard<std::mutex> lock(m_pipelineMutex);
     m_bisFrameSyncOn = !m_bisFrameSyncOn;
     try {
         if (m_bisFrameSyncOn)
             m_pipeline->enableFrameSync();
         else
             m_pipeline->disableFrameSync();
+        // Synchronized framesets need the pipeline, per sensor streaming resumes once sync is off
+        if (m_bIsSensorStreaming) restartPipeline();
 
         return m_bisFrameSyncOn;
     }
@@ -261,28 +345,16 @@ bool Sensors::toggleFrameSync()
         return false;
     }
 }
-bool Sensors::setLaserEnable(bool state)
+void Sensors::setLaserEnable(bool state)
 {
-    try {
-        if (m_device->isPropertySupported(OB_PROP_LASER_BOOL, OB_PERMISSION_WRITE)) {
-            m_device->setBoolProperty(OB_PROP_LASER_BOOL, state);
-        }
-        else {
-            std::cout << "[ERR] Set Laser property not supported" << std::endl;
-        }
-    }
-    catch (...) {
-        std::cout << "[ERR] set property failed: setLaserEnable" << std::endl;
-        return false;
-    }
-    return true;
+    m_controlQueue.setBoolProperty(OB_PROP_LASER_BOOL, state, "Laser");
 }
 int Sensors::getDepthPrecisionLevel()
 {
     int ret = -1;
     try {
-        if (m_device->isPropertySupported(OB_PROP_DEPTH_PRECISION_LEVEL_INT, OB_PERMISSION_READ)) {
-            ret = m_device->getIntProperty(OB_PROP_DEPTH_PRECISION_LEVEL_INT);
+        if (m_propertyCache.isPropertySupported(OB_PROP_DEPTH_PRECISION_LEVEL_INT, OB_PERMISSION_READ)) {
+            ret = m_propertyCache.getIntProperty(OB_PROP_DEPTH_PRECISION_LEVEL_INT);
         }
         else {
             std::cout << "[ERR] Get Depth Precision Level property not supported" << std::endl;
@@ -293,31 +365,43 @@ int Sensors::getDepthPrecisionLevel()
     }
     return ret;
 }
-bool Sensors::setDepthPrecisionLevel(int level)
+void Sensors::setDepthPrecisionLevel(int level)
 {
-    try {
-        if (m_device->isPropertySupported(OB_PROP_DEPTH_PRECISION_LEVEL_INT, OB_PERMISSION_WRITE)) {
-            m_device->setIntProperty(OB_PROP_DEPTH_PRECISION_LEVEL_INT, level);
-        }
-        else {
-            std::cout << "[ERR] Set Depth Precision Level property not supported" << std::endl;
-        }
-    }
-    catch (...) {
-        std::cout << "[ERR] set property failed: setDepthPrecisionLevel" << std::endl;
-        return false;
-    }
-    return true;
+    m_controlQueue.setIntProperty(OB_PROP_DEPTH_PRECISION_LEVEL_INT, level, "Depth Precision Level");
 }
 
 OBCameraParam Sensors::getCameraParams()
 {
-    m_curCameraParams = m_pipeline->getCameraParam();
+    std::lock_guard<std::mutex> lock(m_pipelineMutex);
+    updateCameraParams();
 	return m_curCameraParams;
 }
 
+// Pipeline mutex must be held
+void Sensors::updateCameraParams()
+{
+    if (m_bIsCameraParamValid || m_pipeline == nullptr) return;
+    try {
+        m_curCameraParams = m_pipeline->getCameraParam();
+        m_bIsCameraParamValid = true;
+    }
+    catch (ob::Error& e) {
+        // Keeps the previous parameters, the next call tries again
+        std::cerr << "updateCameraParams: " << e.getName() << "\nargs:" << e.getArgs() << "\nmessage:" << e.getMessage() << "\ntype:" << e.getExceptionType() << std::endl;
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_pointCloudMutex);
+    m_pointCloudParams = m_curCameraParams;
+    m_pointCloudParamVersion++;
+}
+
 FrameInfo_S Sensors::getCurFrameInfo(int frameType)
 {
+    if (m_frameSource != nullptr) {
+        return m_frameSource->getFrameInfo(frameType == 0 ? STREAM_DEPTH : frameType == 1 ? STREAM_COLOR : STREAM_IR);
+    }
+
     FrameInfo_S frameInfo;
     switch (frameType)
     {
@@ -342,21 +426,13 @@ FrameInfo_S Sensors::getCurFrameInfo(int frameType)
 
 void Sensors::setColorVideoMode(int index)
 {
+    std::lock_guard<std::mutex> lock(m_pipelineMutex);
     try {
-        bool bIsStreamOn = m_bIsColorOn;
-        if (bIsStreamOn) {
-            m_curColorFrame.reset();
-            m_pipeline->stop();
-        }
-
         m_colorStreamProfile = m_colorStreamProfileList->getProfile(index)->as<ob::VideoStreamProfile>();
 
-        if (bIsStreamOn) {
-            if (m_bIsColorOn)   m_config->enableStream(m_colorStreamProfile);
-            if (m_bIsDepthOn)   m_config->enableStream(m_depthStreamProfile);
-            if (m_bIsIROn)      m_config->enableStream(m_irStreamProfile);
-            m_pipeline->start(m_config);
-            m_bIsColorOn = true;
+        if (m_bIsColorOn) {
+            clearFrame(STREAM_COLOR);
+            restartPipeline();
         }
     }
     catch (ob::Error& e) {
@@ -366,21 +442,13 @@ void Sensors::setColorVideoMode(int index)
 
 void Sensors::setDepthVideoMode(int index)
 {
+    std::lock_guard<std::mutex> lock(m_pipelineMutex);
     try {
-        bool bIsStreamOn = m_bIsDepthOn;
-        if (bIsStreamOn) {
-            m_curDepthFrame.reset();
-            m_pipeline->stop();
-        }
-
         m_depthStreamProfile = m_depthStreamProfileList->getProfile(index)->as<ob::VideoStreamProfile>();
 
-        if (bIsStreamOn) {
-            if (m_bIsColorOn)   m_config->enableStream(m_colorStreamProfile);
-            if (m_bIsDepthOn)   m_config->enableStream(m_depthStreamProfile);
-            if (m_bIsIROn)      m_config->enableStream(m_irStreamProfile);
-            m_pipeline->start(m_config);
-            m_bIsDepthOn = true;
+        if (m_bIsDepthOn) {
+            clearFrame(STREAM_DEPTH);
+            restartPipeline();
         }
     }
     catch (ob::Error& e) {
@@ -390,21 +458,13 @@ void Sensors::setDepthVideoMode(int index)
 
 void Sensors::setIRVideoMode(int index)
 {
+    std::lock_guard<std::mutex> lock(m_pipelineMutex);
     try {
-        bool bIsStreamOn = m_bIsIROn;
-        if (bIsStreamOn) {
-            m_curIRFrame.reset();
-            m_pipeline->stop();
-        }
-
         m_irStreamProfile = m_irStreamProfileList->getProfile(index)->as<ob::VideoStreamProfile>();
 
-        if (bIsStreamOn) {
-            if (m_bIsColorOn)   m_config->enableStream(m_colorStreamProfile);
-            if (m_bIsDepthOn)   m_config->enableStream(m_depthStreamProfile);
-            if (m_bIsIROn)      m_config->enableStream(m_irStreamProfile);
-            m_pipeline->start(m_config);
-            m_bIsIROn = true;
+        if (m_bIsIROn) {
+            clearFrame(STREAM_IR);
+            restartPipeline();
         }
     }
     catch (ob::Error& e) {
@@ -414,21 +474,13 @@ void Sensors::setIRVideoMode(int index)
 
 void Sensors::setColorVideoMode(int width, int height, int fps)
 {
+    std::lock_guard<std::mutex> lock(m_pipelineMutex);
     try {
-        bool bIsStreamOn = m_bIsColorOn;
-        if (bIsStreamOn) {
-            m_curColorFrame.reset();
-            m_pipeline->stop();
-        }
-
         m_colorStreamProfile = m_colorStreamProfileList->getVideoStreamProfile(width, height, OB_FORMAT_UNKNOWN, fps)->as<ob::VideoStreamProfile>();
 
-        if (bIsStreamOn) {
-            if (m_bIsColorOn)   m_config->enableStream(m_colorStreamProfile);
-            if (m_bIsDepthOn)   m_config->enableStream(m_depthStreamProfile);
-            if (m_bIsIROn)      m_config->enableStream(m_irStreamProfile);
-            m_pipeline->start(m_config);
-            m_bIsColorOn = true;
+        if (m_bIsColorOn) {
+            clearFrame(STREAM_COLOR);
+            restartPipeline();
         }
     }
     catch (ob::Error& e) {
@@ -438,21 +490,13 @@ void Sensors::setColorVideoMode(int width, int height, int fps)
 
 void Sensors::setDepthVideoMode(int width, int height, int fps)
 {
+    std::lock_guard<std::mutex> lock(m_pipelineMutex);
     try {
-        bool bIsStreamOn = m_bIsDepthOn;
-        if (bIsStreamOn) {
-            m_curDepthFrame.reset();
-            m_pipeline->stop();
-        }
-
         m_depthStreamProfile = m_depthStreamProfileList->getVideoStreamProfile(width, height, OB_FORMAT_UNKNOWN, fps)->as<ob::VideoStreamProfile>();
 
-        if (bIsStreamOn) {
-            if (m_bIsColorOn)   m_config->enableStream(m_colorStreamProfile);
-            if (m_bIsDepthOn)   m_config->enableStream(m_depthStreamProfile);
-            if (m_bIsIROn)      m_config->enableStream(m_irStreamProfile);
-            m_pipeline->start(m_config);
-            m_bIsDepthOn = true;
+        if (m_bIsDepthOn) {
+            clearFrame(STREAM_DEPTH);
+            restartPipeline();
         }
     }
     catch (ob::Error& e) {
@@ -462,21 +506,13 @@ void Sensors::setDepthVideoMode(int width, int height, int fps)
 
 void Sensors::setIRVideoMode(int width, int height, int fps)
 {
+    std::lock_guard<std::mutex> lock(m_pipelineMutex);
     try {
-        bool bIsStreamOn = m_bIsIROn;
-        if (bIsStreamOn) {
-            m_curIRFrame.reset();
-            m_pipeline->stop();
-        }
-
         m_irStreamProfile = m_irStreamProfileList->getVideoStreamProfile(width, height, OB_FORMAT_UNKNOWN, fps)->as<ob::VideoStreamProfile>();
 
-        if (bIsStreamOn) {
-            if (m_bIsColorOn)   m_config->enableStream(m_colorStreamProfile);
-            if (m_bIsDepthOn)   m_config->enableStream(m_depthStreamProfile);
-            if (m_bIsIROn)      m_config->enableStream(m_irStreamProfile);
-            m_pipeline->start(m_config);
-            m_bIsIROn = true;
+        if (m_bIsIROn) {
+            clearFrame(STREAM_IR);
+            restartPipeline();
         }
     }
     catch (ob::Error& e) {
@@ -486,15 +522,13 @@ void Sensors::setIRVideoMode(int width, int height, int fps)
 
 int Sensors::startCurColor()
 {
+    std::lock_guard<std::mutex> lock(m_pipelineMutex);
     try {
-        m_pipeline->stop();
-        if (m_bIsDepthOn)   m_config->enableStream(m_depthStreamProfile);
-        if (m_bIsIROn)      m_config->enableStream(m_irStreamProfile);
-        m_config->enableStream(m_colorStreamProfile);
-        m_pipeline->start(m_config);
         m_bIsColorOn = true;
+        restartPipeline();
     }
     catch (ob::Error& e) {
+        m_bIsColorOn = false;
         std::cerr << "startCurColor: " << e.getName() << "\nargs:" << e.getArgs() << "\nmessage:" << e.getMessage() << "\ntype:" << e.getExceptionType() << std::endl;
     }
 
@@ -508,23 +542,17 @@ int Sensors::startCurColor()
 
 void Sensors::stopCurColor()
 {
-    if (m_curColorFrame) {
+    std::lock_guard<std::mutex> lock(m_pipelineMutex);
+    if (m_bIsColorOn) {
         try {
-            m_curColorFrame.reset();
-            m_pipeline->stop();
-            m_config->disableStream(OB_STREAM_COLOR);
-            if (m_bIsDepthOn)   m_config->enableStream(m_depthStreamProfile);
-            if (m_bIsIROn)      m_config->enableStream(m_irStreamProfile);
-            m_pipeline->start(m_config);
             m_bIsColorOn = false;
+            clearFrame(STREAM_COLOR);
+            restartPipeline();
         }
         catch (ob::Error& e) {
             std::cerr << "stopCurColor: " << e.getName() << "\nargs:" << e.getArgs() << "\nmessage:" << e.getMessage() << "\ntype:" << e.getExceptionType() << std::endl;
         }
     }
-    if (m_bIsColorOn) {
-        printf("Couldn't stop COLOR stream.\n");
-    }
 }
 
 void Sensors::getColorInfoFromModeList(int mode, int& width, int& height, int& fps)
@@ -537,18 +565,18 @@ void Sensors::getColorInfoFromModeList(int mode, int& width, int& height, int& f
 
 unsigned char* Sensors::getCurColorData()
 {
-    if (m_curColorFrame == nullptr || m_curColorFrame->dataSize() < 1024) return NULL;
+    const FrameSlot_S& frame = getFrame(STREAM_COLOR);
+    if (frame.data == NULL || frame.dataSize < 1024) return NULL;
 
-    auto videoFrame = m_curColorFrame->as<ob::VideoFrame>();
-    return (unsigned char*)videoFrame->data();
+    return (unsigned char*)frame.data;
 }
 
 bool Sensors::getColorMirror()
 {
     bool ret = false;
     try {
-        if (m_device->isPropertySupported(OB_PROP_COLOR_MIRROR_BOOL, OB_PERMISSION_READ)) {
-            ret = m_device->getBoolProperty(OB_PROP_COLOR_MIRROR_BOOL);
+        if (m_propertyCache.isPropertySupported(OB_PROP_COLOR_MIRROR_BOOL, OB_PERMISSION_READ)) {
+            ret = m_propertyCache.getBoolProperty(OB_PROP_COLOR_MIRROR_BOOL);
         }
         else {
             printf("[ERR] Get Color Mirror property not supported.\n");
@@ -561,25 +589,15 @@ bool Sensors::getColorMirror()
 }
 void Sensors::toggleColorMirror(bool state)
 {
-    try {
-        if (m_device->isPropertySupported(OB_PROP_COLOR_MIRROR_BOOL, OB_PERMISSION_WRITE)) {
-            m_device->setBoolProperty(OB_PROP_COLOR_MIRROR_BOOL, state);
-        }
-        else {
-            printf("[ERR] Set Color Mirror property not supported.\n");
-        }
-    }
-    catch (...) {
-        printf("[ERR] Set Color Mirror property failed.\n");
-    }
+    m_controlQueue.setBoolProperty(OB_PROP_COLOR_MIRROR_BOOL, state, "Color Mirror");
 }
 
 bool Sensors::getColorFlip()
 {
     bool ret = false;
     try {
-        if (m_device->isPropertySupported(OB_PROP_COLOR_FLIP_BOOL, OB_PERMISSION_READ_WRITE)) {
-            ret = m_device->getBoolProperty(OB_PROP_COLOR_FLIP_BOOL);
+        if (m_propertyCache.isPropertySupported(OB_PROP_COLOR_FLIP_BOOL, OB_PERMISSION_READ_WRITE)) {
+            ret = m_propertyCache.getBoolProperty(OB_PROP_COLOR_FLIP_BOOL);
         }
         else {
             printf("[ERR] Get Color Flip property not supported.\n");
@@ -592,25 +610,15 @@ bool Sensors::getColorFlip()
 }
 void Sensors::toggleColorFlip(bool state)
 {
-    try {
-        if (m_device->isPropertySupported(OB_PROP_COLOR_FLIP_BOOL, OB_PERMISSION_WRITE)) {
-            m_device->setBoolProperty(OB_PROP_COLOR_FLIP_BOOL, state);
-        }
-        else {
-            printf("[ERR] Set Color Flip property not supported.\n");
-        }
-    }
-    catch (...) {
-        printf("[ERR] Set Color Flip property failed.\n");
-    }
+    m_controlQueue.setBoolProperty(OB_PROP_COLOR_FLIP_BOOL, state, "Color Flip");
 }
 
 bool Sensors::getAutoWhiteBalanceStatus()
 {
     bool ret = false;
     try {
-        if (m_device->isPropertySupported(OB_PROP_COLOR_AUTO_WHITE_BALANCE_BOOL, OB_PERMISSION_READ)) {
-            ret = m_device->getBoolProperty(OB_PROP_COLOR_AUTO_WHITE_BALANCE_BOOL);
+        if (m_propertyCache.isPropertySupported(OB_PROP_COLOR_AUTO_WHITE_BALANCE_BOOL, OB_PERMISSION_READ)) {
+            ret = m_propertyCache.getBoolProperty(OB_PROP_COLOR_AUTO_WHITE_BALANCE_BOOL);
         }
         else {
             printf("[ERR] Get Color Auto White Balance property not supported.\n");
@@ -623,27 +631,17 @@ bool Sensors::getAutoWhiteBalanceStatus()
 }
 void Sensors::toggleAutoWhiteBalance(bool state)
 {
-    try {
-        if (m_device->isPropertySupported(OB_PROP_COLOR_AUTO_WHITE_BALANCE_BOOL, OB_PERMISSION_WRITE)) {
-            m_device->setBoolProperty(OB_PROP_COLOR_AUTO_WHITE_BALANCE_BOOL, state);
-        }
-        else {
-            printf("[ERR] Set Color Auto White Balance property not supported.\n");
-        }
-    }
-    catch (...) {
-        printf("[ERR] Set Color Auto White Balance property failed.\n");
-    }
+    m_controlQueue.setBoolProperty(OB_PROP_COLOR_AUTO_WHITE_BALANCE_BOOL, state, "Color Auto White Balance");
 }
 
 PropertyInfo_S<int> Sensors::getAutoExposureStatus()
 {
     PropertyInfo_S<int> ret = { false, -1, -1 };
     try {
-        if (m_device->isPropertySupported(OB_PROP_COLOR_AUTO_EXPOSURE_BOOL, OB_PERMISSION_READ)) {
-            ret.state = m_device->getBoolProperty(OB_PROP_COLOR_AUTO_EXPOSURE_BOOL);
+        if (m_propertyCache.isPropertySupported(OB_PROP_COLOR_AUTO_EXPOSURE_BOOL, OB_PERMISSION_READ)) {
+            ret.state = m_propertyCache.getBoolProperty(OB_PROP_COLOR_AUTO_EXPOSURE_BOOL);
             // get the value range
-            OBIntPropertyRange valueRange = m_device->getIntPropertyRange(OB_PROP_COLOR_EXPOSURE_INT);
+            OBIntPropertyRange valueRange = m_propertyCache.getIntPropertyRange(OB_PROP_COLOR_EXPOSURE_INT);
             ret.min = valueRange.min;
             ret.max = valueRange.max;
         }
@@ -658,25 +656,15 @@ PropertyInfo_S<int> Sensors::getAutoExposureStatus()
 }
 void Sensors::toggleAutoExposure(bool state)
 {
-    try {
-        if (m_device->isPropertySupported(OB_PROP_COLOR_AUTO_EXPOSURE_BOOL, OB_PERMISSION_WRITE)) {
-            m_device->setBoolProperty(OB_PROP_COLOR_AUTO_EXPOSURE_BOOL, state);
-        }
-        else {
-            printf("[ERR] Set Color Auto White Exposure property not supported.\n");
-        }
-    }
-    catch (...) {
-        printf("[ERR] Set Color Auto Exposure property failed.\n");
-    }
+    m_controlQueue.setBoolProperty(OB_PROP_COLOR_AUTO_EXPOSURE_BOOL, state, "Color Auto Exposure");
 }
 
 int Sensors::getColorExposureValue()
 {
     int ret = 0;
     try {
-        if (m_device->isPropertySupported(OB_PROP_COLOR_EXPOSURE_INT, OB_PERMISSION_READ)) {
-            ret = m_device->getIntProperty(OB_PROP_COLOR_EXPOSURE_INT);
+        if (m_propertyCache.isPropertySupported(OB_PROP_COLOR_EXPOSURE_INT, OB_PERMISSION_READ)) {
+            ret = m_propertyCache.getIntProperty(OB_PROP_COLOR_EXPOSURE_INT);
         }
         else {
             printf("[ERR] Get Color Exposure property not supported.\n");
@@ -690,26 +678,16 @@ int Sensors::getColorExposureValue()
 }
 void Sensors::setColorExposureValue(int value)
 {
-    try {
-        if (m_device->isPropertySupported(OB_PROP_COLOR_EXPOSURE_INT, OB_PERMISSION_WRITE)) {
-            m_device->setIntProperty(OB_PROP_COLOR_EXPOSURE_INT, value);
-        }
-        else {
-            printf("[ERR] Set Color Exposure property not supported.\n");
-        }
-    }
-    catch (...) {
-        printf("[ERR] Set Color Exposure value failed.\n");
-    }
+    m_controlQueue.setIntProperty(OB_PROP_COLOR_EXPOSURE_INT, value, "Color Exposure");
 }
 
 PropertyInfo_S<int> Sensors::getColorGainRange()
 {
     PropertyInfo_S<int> ret = { false, -1, -1 };
     try {
-        if (m_device->isPropertySupported(OB_PROP_COLOR_GAIN_INT, OB_PERMISSION_READ)) {
+        if (m_propertyCache.isPropertySupported(OB_PROP_COLOR_GAIN_INT, OB_PERMISSION_READ)) {
             // get the value range
-            OBIntPropertyRange valueRange = m_device->getIntPropertyRange(OB_PROP_COLOR_GAIN_INT);
+            OBIntPropertyRange valueRange = m_propertyCache.getIntPropertyRange(OB_PROP_COLOR_GAIN_INT);
             ret.min = valueRange.min;
             ret.max = valueRange.max;
         }
@@ -726,8 +704,8 @@ int Sensors::getColorGainValue()
 {
     int ret = 0;
     try {
-        if (m_device->isPropertySupported(OB_PROP_COLOR_GAIN_INT, OB_PERMISSION_READ)) {
-            ret = m_device->getIntProperty(OB_PROP_COLOR_GAIN_INT);
+        if (m_propertyCache.isPropertySupported(OB_PROP_COLOR_GAIN_INT, OB_PERMISSION_READ)) {
+            ret = m_propertyCache.getIntProperty(OB_PROP_COLOR_GAIN_INT);
         }
         else {
             printf("[ERR] Get Color Gain property not supported.\n");
@@ -741,30 +719,18 @@ int Sensors::getColorGainValue()
 }
 void Sensors::setColorGainValue(int value)
 {
-    try {
-        if (m_device->isPropertySupported(OB_PROP_COLOR_GAIN_INT, OB_PERMISSION_WRITE)) {
-            m_device->setIntProperty(OB_PROP_COLOR_GAIN_INT, value);
-        }
-        else {
-            printf("[ERR] Set Color Gain property not supported.\n");
-        }
-    }
-    catch (...) {
-        printf("[ERR] Set Color Gain value failed.\n");
-    }
+    m_controlQueue.setIntProperty(OB_PROP_COLOR_GAIN_INT, value, "Color Gain");
 }
 
 int Sensors::startCurDepth()
 {
+    std::lock_guard<std::mutex> lock(m_pipelineMutex);
     try {
-        m_pipeline->stop();
-        if (m_bIsColorOn)   m_config->enableStream(m_colorStreamProfile);
-        if (m_bIsIROn)      m_config->enableStream(m_irStreamProfile);
-        m_config->enableStream(m_depthStreamProfile);
-        m_pipeline->start(m_config);
         m_bIsDepthOn = true;
+        restartPipeline();
     }
     catch (ob::Error& e) {
+        m_bIsDepthOn = false;
         std::cerr << "startCurDepth: " << e.getName() << "\nargs:" << e.getArgs() << "\nmessage:" << e.getMessage() << "\ntype:" << e.getExceptionType() << std::endl;
     }
 
@@ -778,39 +744,33 @@ int Sensors::startCurDepth()
 
 void Sensors::stopCurDepth()
 {
-    if (m_curDepthFrame) {
+    std::lock_guard<std::mutex> lock(m_pipelineMutex);
+    if (m_bIsDepthOn) {
         try {
-            m_curDepthFrame.reset();
-            m_pipeline->stop();
-            m_config->disableStream(OB_STREAM_DEPTH);
-            if (m_bIsColorOn)   m_config->enableStream(m_colorStreamProfile);
-            if (m_bIsIROn)      m_config->enableStream(m_irStreamProfile);
-            m_pipeline->start(m_config);
             m_bIsDepthOn = false;
+            clearFrame(STREAM_DEPTH);
+            restartPipeline();
         }
         catch (ob::Error& e) {
             std::cerr << "stopCurDepth: " << e.getName() << "\nargs:" << e.getArgs() << "\nmessage:" << e.getMessage() << "\ntype:" << e.getExceptionType() << std::endl;
         }
     }
-    if (m_bIsDepthOn) {
-        printf("Couldn't stop DEPTH stream.\n");
-    }
 }
 
 unsigned char* Sensors::getCurDepthData()
 {
-    if (m_curDepthFrame == nullptr || m_curDepthFrame->dataSize() < 1024) return NULL;
+    const FrameSlot_S& frame = getFrame(STREAM_DEPTH);
+    if (frame.data == NULL || frame.dataSize < 1024) return NULL;
 
-    auto videoFrame = m_curDepthFrame->as<ob::VideoFrame>();
-    return (unsigned char*)videoFrame->data();
+    return (unsigned char*)frame.data;
 }
 
 bool Sensors::getDepthMirror()
 {
     bool ret = false;
     try {
-        if (m_device->isPropertySupported(OB_PROP_DEPTH_MIRROR_BOOL, OB_PERMISSION_READ)) {
-            ret = m_device->getBoolProperty(OB_PROP_DEPTH_MIRROR_BOOL);
+        if (m_propertyCache.isPropertySupported(OB_PROP_DEPTH_MIRROR_BOOL, OB_PERMISSION_READ)) {
+            ret = m_propertyCache.getBoolProperty(OB_PROP_DEPTH_MIRROR_BOOL);
         }
         else {
             printf("[ERR] Get Depth Mirror property not supported.\n");
@@ -823,25 +783,15 @@ bool Sensors::getDepthMirror()
 }
 void Sensors::toggleDepthMirror(bool state)
 {
-    try {
-        if (m_device->isPropertySupported(OB_PROP_DEPTH_MIRROR_BOOL, OB_PERMISSION_WRITE)) {
-            m_device->setBoolProperty(OB_PROP_DEPTH_MIRROR_BOOL, state);
-        }
-        else {
-            printf("[ERR] Set Depth Mirror property not supported.\n");
-        }
-    }
-    catch (...) {
-        printf("[ERR] Set Depth Mirror property failed.\n");
-    }
+    m_controlQueue.setBoolProperty(OB_PROP_DEPTH_MIRROR_BOOL, state, "Depth Mirror");
 }
 
 bool Sensors::getDepthFlip()
 {
     bool ret = false;
     try {
-        if (m_device->isPropertySupported(OB_PROP_DEPTH_FLIP_BOOL, OB_PERMISSION_READ)) {
-            ret = m_device->getBoolProperty(OB_PROP_DEPTH_FLIP_BOOL);
+        if (m_propertyCache.isPropertySupported(OB_PROP_DEPTH_FLIP_BOOL, OB_PERMISSION_READ)) {
+            ret = m_propertyCache.getBoolProperty(OB_PROP_DEPTH_FLIP_BOOL);
         }
         else {
             printf("[ERR] Get Depth Flip property not supported.\n");
@@ -854,27 +804,17 @@ bool Sensors::getDepthFlip()
 }
 void Sensors::toggleDepthFlip(bool state)
 {
-    try {
-        if (m_device->isPropertySupported(OB_PROP_DEPTH_FLIP_BOOL, OB_PERMISSION_WRITE)) {
-            m_device->setBoolProperty(OB_PROP_DEPTH_FLIP_BOOL, state);
-        }
-        else {
-            printf("[ERR] Set Depth Flip property not supported.\n");
-        }
-    }
-    catch (...) {
-        printf("[ERR] Set Depth Flip property failed.\n");
-    }
+    m_controlQueue.setBoolProperty(OB_PROP_DEPTH_FLIP_BOOL, state, "Depth Flip");
 }
 
 PropertyInfo_S<int> Sensors::getDepthAutoExposureStatus()
 {
     PropertyInfo_S<int> ret = { false, -1, -1 };
     try {
-        if (m_device->isPropertySupported(OB_PROP_DEPTH_AUTO_EXPOSURE_BOOL, OB_PERMISSION_READ)) {
-            ret.state = m_device->getBoolProperty(OB_PROP_DEPTH_AUTO_EXPOSURE_BOOL);
+        if (m_propertyCache.isPropertySupported(OB_PROP_DEPTH_AUTO_EXPOSURE_BOOL, OB_PERMISSION_READ)) {
+            ret.state = m_propertyCache.getBoolProperty(OB_PROP_DEPTH_AUTO_EXPOSURE_BOOL);
             // get the value range
-            OBIntPropertyRange valueRange = m_device->getIntPropertyRange(OB_PROP_DEPTH_EXPOSURE_INT);
+            OBIntPropertyRange valueRange = m_propertyCache.getIntPropertyRange(OB_PROP_DEPTH_EXPOSURE_INT);
             ret.min = valueRange.min;
             ret.max = valueRange.max;
         }
@@ -889,25 +829,15 @@ PropertyInfo_S<int> Sensors::getDepthAutoExposureStatus()
 }
 void Sensors::toggleDepthAutoExposure(bool state)
 {
-    try {
-        if (m_device->isPropertySupported(OB_PROP_DEPTH_AUTO_EXPOSURE_BOOL, OB_PERMISSION_WRITE)) {
-            m_device->setBoolProperty(OB_PROP_DEPTH_AUTO_EXPOSURE_BOOL, state);
-        }
-        else {
-            printf("[ERR] Set Depth Auto Exposure property not supported.\n");
-        }
-    }
-    catch (...) {
-        printf("[ERR] Set Depth Auto Exposure property failed.\n");
-    }
+    m_controlQueue.setBoolProperty(OB_PROP_DEPTH_AUTO_EXPOSURE_BOOL, state, "Depth Auto Exposure");
 }
 
 int Sensors::getDepthExposureValue()
 {
     int ret = 0;
     try {
-        if (m_device->isPropertySupported(OB_PROP_DEPTH_EXPOSURE_INT, OB_PERMISSION_READ)) {
-            ret = m_device->getIntProperty(OB_PROP_DEPTH_EXPOSURE_INT);
+        if (m_propertyCache.isPropertySupported(OB_PROP_DEPTH_EXPOSURE_INT, OB_PERMISSION_READ)) {
+            ret = m_propertyCache.getIntProperty(OB_PROP_DEPTH_EXPOSURE_INT);
         }
         else {
             printf("[ERR] Get Depth Exposure property not supported.\n");
@@ -921,26 +851,16 @@ int Sensors::getDepthExposureValue()
 }
 void Sensors::setDepthExposureValue(int value)
 {
-    try {
-        if (m_device->isPropertySupported(OB_PROP_DEPTH_EXPOSURE_INT, OB_PERMISSION_WRITE)) {
-            m_device->setIntProperty(OB_PROP_DEPTH_EXPOSURE_INT, value);
-        }
-        else {
-            printf("[ERR] Set Depth Exposure property not supported.\n");
-        }
-    }
-    catch (...) {
-        printf("[ERR] Set Depth Exposure value failed.\n");
-    }
+    m_controlQueue.setIntProperty(OB_PROP_DEPTH_EXPOSURE_INT, value, "Depth Exposure");
 }
 
 PropertyInfo_S<int> Sensors::getDepthGainRange()
 {
     PropertyInfo_S<int> ret = { false, -1, -1 };
     try {
-        if (m_device->isPropertySupported(OB_PROP_DEPTH_GAIN_INT, OB_PERMISSION_READ)) {
+        if (m_propertyCache.isPropertySupported(OB_PROP_DEPTH_GAIN_INT, OB_PERMISSION_READ)) {
             // get the value range
-            OBIntPropertyRange valueRange = m_device->getIntPropertyRange(OB_PROP_DEPTH_GAIN_INT);
+            OBIntPropertyRange valueRange = m_propertyCache.getIntPropertyRange(OB_PROP_DEPTH_GAIN_INT);
             ret.min = valueRange.min;
             ret.max = valueRange.max;
         }
@@ -957,8 +877,8 @@ int Sensors::getDepthGainValue()
 {
     int ret = 0;
     try {
-        if (m_device->isPropertySupported(OB_PROP_DEPTH_GAIN_INT, OB_PERMISSION_READ)) {
-            ret = m_device->getIntProperty(OB_PROP_DEPTH_GAIN_INT);
+        if (m_propertyCache.isPropertySupported(OB_PROP_DEPTH_GAIN_INT, OB_PERMISSION_READ)) {
+            ret = m_propertyCache.getIntProperty(OB_PROP_DEPTH_GAIN_INT);
         }
         else {
             printf("[ERR] Get Depth Gain property not supported.\n");
@@ -972,25 +892,15 @@ int Sensors::getDepthGainValue()
 }
 void Sensors::setDepthGainValue(int value)
 {
-    try {
-        if (m_device->isPropertySupported(OB_PROP_DEPTH_GAIN_INT, OB_PERMISSION_WRITE)) {
-            m_device->setIntProperty(OB_PROP_DEPTH_GAIN_INT, value);
-        }
-        else {
-            printf("[ERR] Set Depth Gain property not supported.\n");
-        }
-    }
-    catch (...) {
-        printf("[ERR] Set Depth Gain value failed.\n");
-    }
+    m_controlQueue.setIntProperty(OB_PROP_DEPTH_GAIN_INT, value, "Depth Gain");
 }
 
 bool Sensors::getLDPStatus()
 {
     bool ret = false;
     try {
-        if (m_device->isPropertySupported(OB_PROP_LDP_STATUS_BOOL, OB_PERMISSION_READ)) {
-            ret = m_device->getBoolProperty(OB_PROP_LDP_STATUS_BOOL);
+        if (m_propertyCache.isPropertySupported(OB_PROP_LDP_STATUS_BOOL, OB_PERMISSION_READ)) {
+            ret = m_propertyCache.getBoolProperty(OB_PROP_LDP_STATUS_BOOL);
         }
         else {
             printf("[ERR] Get LDP Status property not supported.\n");
@@ -1003,17 +913,7 @@ bool Sensors::getLDPStatus()
 }
 void Sensors::toggleLDP(bool state)
 {
-    try {
-        if (m_device->isPropertySupported(OB_PROP_LDP_STATUS_BOOL, OB_PERMISSION_WRITE)) {
-            m_device->setBoolProperty(OB_PROP_LDP_STATUS_BOOL, state);
-        }
-        else {
-            printf("[ERR] Set LDP Status property not supported.\n");
-        }
-    }
-    catch (...) {
-        printf("[ERR] Set LDP property failed.\n");
-    }
+    m_controlQueue.setBoolProperty(OB_PROP_LDP_STATUS_BOOL, state, "LDP Status");
 }
 
 
@@ -1021,8 +921,8 @@ bool Sensors::getMDCAStatus()
 {
     bool ret = false;
     try {
-        if (m_device->isPropertySupported(OB_PROP_HARDWARE_DISTORTION_SWITCH_BOOL, OB_PERMISSION_READ)) {
-            ret = m_device->getBoolProperty(OB_PROP_HARDWARE_DISTORTION_SWITCH_BOOL);
+        if (m_propertyCache.isPropertySupported(OB_PROP_HARDWARE_DISTORTION_SWITCH_BOOL, OB_PERMISSION_READ)) {
+            ret = m_propertyCache.getBoolProperty(OB_PROP_HARDWARE_DISTORTION_SWITCH_BOOL);
         }
         else {
             printf("[ERR] Get Hardware Distortion property not supported.\n");
@@ -1035,49 +935,43 @@ bool Sensors::getMDCAStatus()
 }
 void Sensors::toggleMDCA(bool state)
 {
-    try {
-        if (m_device->isPropertySupported(OB_PROP_HARDWARE_DISTORTION_SWITCH_BOOL, OB_PERMISSION_WRITE)) {
-            m_device->setBoolProperty(OB_PROP_HARDWARE_DISTORTION_SWITCH_BOOL, state);
-        }
-        else {
-            printf("[ERR] Set Hardware Distortion property not supported.\n");
-        }
-    }
-    catch (...) {
-        printf("[ERR] Set Hardware Distortion failed.\n");
-    }
+    m_controlQueue.setBoolProperty(OB_PROP_HARDWARE_DISTORTION_SWITCH_BOOL, state, "Hardware Distortion");
 }
+// Queued on the control thread, switching takes a while; getCurDepthWorkMode() follows once the device switched
 bool Sensors::setDepthWorkMode(int mode)
 {
-    try {
-        auto ret = m_device->switchDepthWorkMode(m_deviceDepthModeStringList[mode].c_str());
-
-        auto curDepthMode = m_device->getCurrentDepthWorkMode();
-        if (strcmp(curDepthMode.name, m_deviceDepthModeStringList[mode].c_str()) == 0) {
+    if (mode < 0 || mode >= (int)m_deviceDepthModeStringList.size()) return false;
+    std::string modeName = m_deviceDepthModeStringList[mode];
+    m_controlQueue.post([this, mode, modeName](std::shared_ptr<ob::Device> device) {
+        if (device == nullptr) return;
+        device->switchDepthWorkMode(modeName.c_str());
+        // A work mode carries its own exposure, gain and precision settings
+        m_propertyCache.invalidateAll();
+
+        auto curDepthMode = device->getCurrentDepthWorkMode();
+        if (strcmp(curDepthMode.name, modeName.c_str()) == 0) {
+            m_curDeviceDepthMode = mode;
             std::cout << "Switch depth work mode success! currentDepthMode: " << curDepthMode.name << std::endl;
         }
         else {
             std::cout << "Switch depth work mode failed!" << std::endl;
         }
-        return !ret;
-    }
-    catch (ob::Error& e) {
-        std::cerr << "function:" << e.getName() << "\nargs:" << e.getArgs() << "\nmessage:" << e.getMessage() << "\ntype:" << e.getExceptionType() << std::endl;
-        return false;
-    }
+        if (m_propertyCache.isPropertySupported(OB_PROP_DEPTH_PRECISION_LEVEL_INT, OB_PERMISSION_READ)) {
+            m_depthValueScale = OBDepthPrecisionLevelToFloat((OBDepthPrecisionLevel)m_propertyCache.getIntProperty(OB_PROP_DEPTH_PRECISION_LEVEL_INT));
+        }
+    }, "setDepthWorkMode");
+    return true;
 }
 
 int Sensors::startCurIR()
 {
+    std::lock_guard<std::mutex> lock(m_pipelineMutex);
     try {
-        m_pipeline->stop();
-        if (m_bIsColorOn)   m_config->enableStream(m_colorStreamProfile);
-        if (m_bIsDepthOn)   m_config->enableStream(m_depthStreamProfile);
-        m_config->enableStream(m_irStreamProfile);
-        m_pipeline->start(m_config);
         m_bIsIROn = true;
+        restartPipeline();
     }
     catch (ob::Error& e) {
+        m_bIsIROn = false;
         std::cerr << "startCurIR: " << e.getName() << "\nargs:" << e.getArgs() << "\nmessage:" << e.getMessage() << "\ntype:" << e.getExceptionType() << std::endl;
     }
 
@@ -1091,39 +985,33 @@ int Sensors::startCurIR()
 
 void Sensors::stopCurIR()
 {
-    if (m_curIRFrame) {
+    std::lock_guard<std::mutex> lock(m_pipelineMutex);
+    if (m_bIsIROn) {
         try {
-            m_curIRFrame.reset();
-            m_pipeline->stop();
-            m_config->disableStream(OB_STREAM_IR);
-            if (m_bIsColorOn)   m_config->enableStream(m_colorStreamProfile);
-            if (m_bIsDepthOn)   m_config->enableStream(m_depthStreamProfile);
-            m_pipeline->start(m_config);
             m_bIsIROn = false;
+            clearFrame(STREAM_IR);
+            restartPipeline();
         }
         catch (ob::Error& e) {
             std::cerr << "stopCurIR: " << e.getName() << "\nargs:" << e.getArgs() << "\nmessage:" << e.getMessage() << "\ntype:" << e.getExceptionType() << std::endl;
         }
     }
-    if (m_bIsIROn) {
-        printf("Couldn't stop IR stream.\n");
-    }
 }
 
 unsigned char* Sensors::getCurIRData()
 {
-    if (m_curIRFrame == nullptr || m_curIRFrame->dataSize() < 1024) return NULL;
+    const FrameSlot_S& frame = getFrame(STREAM_IR);
+    if (frame.data == NULL || frame.dataSize < 1024) return NULL;
 
-    auto videoFrame = m_curIRFrame->as<ob::VideoFrame>();
-    return (unsigned char*)videoFrame->data();
+    return (unsigned char*)frame.data;
 }
 
 bool Sensors::getIRMirror()
 {
     bool ret = false;
     try {
-        if (m_device->isPropertySupported(OB_PROP_IR_MIRROR_BOOL, OB_PERMISSION_READ)) {
-            ret = m_device->getBoolProperty(OB_PROP_IR_MIRROR_BOOL);
+        if (m_propertyCache.isPropertySupported(OB_PROP_IR_MIRROR_BOOL, OB_PERMISSION_READ)) {
+            ret = m_propertyCache.getBoolProperty(OB_PROP_IR_MIRROR_BOOL);
         }
         else {
             printf("[ERR] Get IR Mirror property not supported.\n");
@@ -1136,25 +1024,15 @@ bool Sensors::getIRMirror()
 }
 void Sensors::toggleIRMirror(bool state)
 {
-    try {
-        if (m_device->isPropertySupported(OB_PROP_IR_MIRROR_BOOL, OB_PERMISSION_WRITE)) {
-            m_device->setBoolProperty(OB_PROP_IR_MIRROR_BOOL, state);
-        }
-        else {
-            printf("[ERR] Set IR Mirror property not supported.\n");
-        }
-    }
-    catch (...) {
-        printf("[ERR] Set IR Mirror property failed.\n");
-    }
+    m_controlQueue.setBoolProperty(OB_PROP_IR_MIRROR_BOOL, state, "IR Mirror");
 }
 
 bool Sensors::getIRFlip()
 {
     bool ret = false;
     try {
-        if (m_device->isPropertySupported(OB_PROP_IR_FLIP_BOOL, OB_PERMISSION_READ)) {
-            ret = m_device->getBoolProperty(OB_PROP_IR_FLIP_BOOL);
+        if (m_propertyCache.isPropertySupported(OB_PROP_IR_FLIP_BOOL, OB_PERMISSION_READ)) {
+            ret = m_propertyCache.getBoolProperty(OB_PROP_IR_FLIP_BOOL);
         }
         else {
             printf("[ERR] Get IR Flip property not supported.\n");
@@ -1167,25 +1045,15 @@ bool Sensors::getIRFlip()
 }
 void Sensors::toggleIRFlip(bool state)
 {
-    try {
-        if (m_device->isPropertySupported(OB_PROP_IR_FLIP_BOOL, OB_PERMISSION_WRITE)) {
-            m_device->setBoolProperty(OB_PROP_IR_FLIP_BOOL, state);
-        }
-        else {
-            printf("[ERR] Set IR Flip property not supported.\n");
-        }
-    }
-    catch (...) {
-        printf("[ERR] Set IR Flip property failed.\n");
-    }
+    m_controlQueue.setBoolProperty(OB_PROP_IR_FLIP_BOOL, state, "IR Flip");
 }
 
 bool Sensors::getIRFloodStatus()
 {
     bool ret = false;
     try {
-        if (m_device->isPropertySupported(OB_PROP_FLOOD_BOOL, OB_PERMISSION_READ)) {
-            ret = m_device->getBoolProperty(OB_PROP_FLOOD_BOOL);
+        if (m_propertyCache.isPropertySupported(OB_PROP_FLOOD_BOOL, OB_PERMISSION_READ)) {
+            ret = m_propertyCache.getBoolProperty(OB_PROP_FLOOD_BOOL);
         }
         else {
             printf("[ERR] Get IR Flood property not supported.\n");
@@ -1198,27 +1066,17 @@ bool Sensors::getIRFloodStatus()
 }
 void Sensors::toggleIRFlood(bool state)
 {
-    try {
-        if (m_device->isPropertySupported(OB_PROP_FLOOD_BOOL, OB_PERMISSION_WRITE)) {
-            m_device->setBoolProperty(OB_PROP_FLOOD_BOOL, state);
-        }
-        else {
-            printf("[ERR] Set IR Flood property not supported.\n");
-        }
-    }
-    catch (...) {
-        printf("[ERR] Set IR Flood property failed.\n");
-    }
+    m_controlQueue.setBoolProperty(OB_PROP_FLOOD_BOOL, state, "IR Flood");
 }
 
 PropertyInfo_S<int> Sensors::getIRAutoExposureStatus()
 {
     PropertyInfo_S<int> ret = { false, -1, -1 };
     try {
-        if (m_device->isPropertySupported(OB_PROP_IR_AUTO_EXPOSURE_BOOL, OB_PERMISSION_READ)) {
-            ret.state = m_device->getBoolProperty(OB_PROP_IR_AUTO_EXPOSURE_BOOL);
+        if (m_propertyCache.isPropertySupported(OB_PROP_IR_AUTO_EXPOSURE_BOOL, OB_PERMISSION_READ)) {
+            ret.state = m_propertyCache.getBoolProperty(OB_PROP_IR_AUTO_EXPOSURE_BOOL);
             // get the value range
-            OBIntPropertyRange valueRange = m_device->getIntPropertyRange(OB_PROP_IR_EXPOSURE_INT);
+            OBIntPropertyRange valueRange = m_propertyCache.getIntPropertyRange(OB_PROP_IR_EXPOSURE_INT);
             ret.min = valueRange.min;
             ret.max = valueRange.max;
         }
@@ -1233,25 +1091,15 @@ PropertyInfo_S<int> Sensors::getIRAutoExposureStatus()
 }
 void Sensors::toggleIRAutoExposure(bool state)
 {
-    try {
-        if (m_device->isPropertySupported(OB_PROP_IR_AUTO_EXPOSURE_BOOL, OB_PERMISSION_WRITE)) {
-            m_device->setBoolProperty(OB_PROP_IR_AUTO_EXPOSURE_BOOL, state);
-        }
-        else {
-            printf("[ERR] Set IR Auto Exposure property not supported.\n");
-        }
-    }
-    catch (...) {
-        printf("[ERR] Set IR Auto Exposure property failed.\n");
-    }
+    m_controlQueue.setBoolProperty(OB_PROP_IR_AUTO_EXPOSURE_BOOL, state, "IR Auto Exposure");
 }
 
 int Sensors::getIRExposureValue()
 {
     int ret = 0;
     try {
-        if (m_device->isPropertySupported(OB_PROP_IR_EXPOSURE_INT, OB_PERMISSION_READ)) {
-            ret = m_device->getIntProperty(OB_PROP_IR_EXPOSURE_INT);
+        if (m_propertyCache.isPropertySupported(OB_PROP_IR_EXPOSURE_INT, OB_PERMISSION_READ)) {
+            ret = m_propertyCache.getIntProperty(OB_PROP_IR_EXPOSURE_INT);
         }
         else {
             printf("[ERR] Get IR Exposure property not supported.\n");
@@ -1265,26 +1113,16 @@ int Sensors::getIRExposureValue()
 }
 void Sensors::setIRExposureValue(int value)
 {
-    try {
-        if (m_device->isPropertySupported(OB_PROP_IR_EXPOSURE_INT, OB_PERMISSION_WRITE)) {
-            m_device->setIntProperty(OB_PROP_IR_EXPOSURE_INT, value);
-        }
-        else {
-            printf("[ERR] Set IR Exposure property not supported.\n");
-        }
-    }
-    catch (...) {
-        printf("[ERR] Set IR Exposure value failed.\n");
-    }
+    m_controlQueue.setIntProperty(OB_PROP_IR_EXPOSURE_INT, value, "IR Exposure");
 }
 
 PropertyInfo_S<int> Sensors::getIRGainRange()
 {
     PropertyInfo_S<int> ret = { false, -1, -1 };
     try {
-        if (m_device->isPropertySupported(OB_PROP_IR_GAIN_INT, OB_PERMISSION_READ)) {
+        if (m_propertyCache.isPropertySupported(OB_PROP_IR_GAIN_INT, OB_PERMISSION_READ)) {
             // get the value range
-            OBIntPropertyRange valueRange = m_device->getIntPropertyRange(OB_PROP_IR_GAIN_INT);
+            OBIntPropertyRange valueRange = m_propertyCache.getIntPropertyRange(OB_PROP_IR_GAIN_INT);
             ret.min = valueRange.min;
             ret.max = valueRange.max;
         }
@@ -1301,8 +1139,8 @@ int Sensors::getIRGainValue()
 {
     int ret = 0;
     try {
-        if (m_device->isPropertySupported(OB_PROP_IR_GAIN_INT, OB_PERMISSION_READ)) {
-            ret = m_device->getIntProperty(OB_PROP_IR_GAIN_INT);
+        if (m_propertyCache.isPropertySupported(OB_PROP_IR_GAIN_INT, OB_PERMISSION_READ)) {
+            ret = m_propertyCache.getIntProperty(OB_PROP_IR_GAIN_INT);
         }
         else {
             printf("[ERR] Get IR Gain property not supported.\n");
@@ -1316,105 +1154,521 @@ int Sensors::getIRGainValue()
 }
 void Sensors::setIRGainValue(int value)
 {
+    m_controlQueue.setIntProperty(OB_PROP_IR_GAIN_INT, value, "IR Gain");
+}
+
+void Sensors::togglePointCloud() {
+    std::lock_guard<std::mutex> lock(m_pipelineMutex);
+    if (m_bIsPointCloudOn) {
+        stopPointCloud();
+    }
+    else {
+        m_bIsPointCloudOn = true;
+        updateCameraParams();
+        m_pointCloudThread = std::thread(&Sensors::pointCloudLoop, this);
+    }
     try {
-        if (m_device->isPropertySupported(OB_PROP_IR_GAIN_INT, OB_PERMISSION_WRITE)) {
-            m_device->setIntProperty(OB_PROP_IR_GAIN_INT, value);
+        // The point cloud is made of pipeline framesets, per sensor streaming resumes once it is off
+        if (m_bIsSensorStreaming && !m_bIsD2CAlignmentOn && !m_bisFrameSyncOn) restartPipeline();
+    }
+    catch (ob::Error& e) {
+        std::cerr << "togglePointCloud: " << e.getName() << "\nargs:" << e.getArgs() << "\nmessage:" << e.getMessage() << "\ntype:" << e.getExceptionType() << std::endl;
+    }
+}
+
+void Sensors::stopPointCloud()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_pointCloudMutex);
+        m_bIsPointCloudOn = false;
+        m_pointCloudFrameSet.reset();
+    }
+    m_pointCloudCond.notify_one();
+    if (m_pointCloudThread.joinable()) {
+        m_pointCloudThread.join();
+    }
+
+    // The thread is gone, this is the only writer now; the next session starts without points
+    PointCloudSlot_S& slot = m_pointClouds.back();
+    slot.holder.reset();
+    slot.points = nullptr;
+    slot.count = 0;
+    m_pointClouds.publish();
+}
+
+void Sensors::pointCloudLoop()
+{
+    OB_TRACE_THREAD("pointcloud");
+    // Kept for the whole session, together with the camera parameters it was given
+    ob::PointCloudFilter pointCloud;
+    uint32_t paramVersion = 0;
+    while (m_bIsPointCloudOn) {
+        std::shared_ptr<ob::FrameSet> frameSet;
+        {
+            std::unique_lock<std::mutex> lock(m_pointCloudMutex);
+            m_pointCloudCond.wait_for(lock, std::chrono::milliseconds(100), [this]() {
+                return m_pointCloudFrameSet != nullptr || !m_bIsPointCloudOn;
+            });
+            frameSet.swap(m_pointCloudFrameSet);
+            if (frameSet != nullptr && paramVersion != m_pointCloudParamVersion) {
+                pointCloud.setCameraParam(m_pointCloudParams);
+                paramVersion = m_pointCloudParamVersion;
+            }
         }
-        else {
-            printf("[ERR] Set IR Gain property not supported.\n");
+        if (frameSet == nullptr || frameSet->depthFrame() == nullptr || paramVersion == 0) continue;
+
+        bool isColor = m_bIsPointCloudColor && frameSet->colorFrame() != nullptr;
+        PointCloudSlot_S& slot = m_pointClouds.back();
+        try {
+            OB_TRACE_SCOPE("PointCloudFilter::process");
+            // point position value multiply depth value scale to convert uint to millimeter (for some devices, the default depth value uint is not millimeter)
+            pointCloud.setPositionDataScaled(frameSet->depthFrame()->getValueScale());
+            pointCloud.setCreatePointFormat(isColor ? OB_FORMAT_RGB_POINT : OB_FORMAT_POINT);
+            std::shared_ptr<ob::Frame> frame = pointCloud.process(frameSet);
+            if (frame == nullptr) continue;
+
+            if (isColor) {
+                // Already laid out as OBColorPoint, handed over without a copy
+                slot.holder = frame;
+                slot.points = (const OBColorPoint*)frame->data();
+                slot.count = frame->dataSize() / sizeof(OBColorPoint);
+            }
+            else {
+                // Shade by distance; the buffer keeps its capacity, so this allocates only on a larger cloud
+                const float max_dis = 5120.0f;
+                const OBPoint* point = (const OBPoint*)frame->data();
+                size_t pointsSize = frame->dataSize() / sizeof(OBPoint);
+                slot.holder.reset();
+                slot.buffer.resize(pointsSize);
+                OBColorPoint* colorPoint = slot.buffer.data();
+                for (size_t i = 0; i < pointsSize; i++) {
+                    float shade = point[i].z / max_dis * 255;
+                    colorPoint[i].x = point[i].x;
+                    colorPoint[i].y = point[i].y;
+                    colorPoint[i].z = point[i].z;
+                    colorPoint[i].r = colorPoint[i].g = colorPoint[i].b = shade;
+                }
+                slot.points = colorPoint;
+                slot.count = pointsSize;
+            }
+            slot.index = frameSet->depthFrame()->index();
+            m_pointClouds.publish();
+        }
+        catch (ob::Error& e) {
+            std::cerr << "pointCloudLoop: " << e.getName() << "\nargs:" << e.getArgs() << "\nmessage:" << e.getMessage() << "\ntype:" << e.getExceptionType() << std::endl;
         }
     }
-    catch (...) {
-        printf("[ERR] Set IR Gain value failed.\n");
+}
+
+void Sensors::startPipeline()
+{
+    if (m_acquisitionMode == ACQUISITION_CALLBACK) {
+        // Runs on the SDK callback thread, the only producer of m_frameRing
+        m_pipeline->start(m_config, [this](std::shared_ptr<ob::FrameSet> frameSet) {
+            if (frameSet != nullptr && m_frameRing.push(frameSet)) m_acquisitionCond.notify_one();
+        });
+    }
+    else {
+        m_pipeline->start(m_config);
     }
+    setPipelineStarted(true);
 }
 
-void Sensors::togglePointCloud() {
-    m_bIsPointCloudOn = !m_bIsPointCloudOn;
-    m_curCameraParams = m_pipeline->getCameraParam();
+// Every stop goes through here so the acquisition thread stops waiting on the pipeline first
+void Sensors::stopPipeline()
+{
+    setPipelineStarted(false);
+    m_pipeline->stop();
+
+    // Framesets queued for the stopped configuration must not be published after it
+    std::lock_guard<std::mutex> lock(m_acquisitionMutex);
+    m_frameRing.clear();
 }
 
-void Sensors::generatePointCloudPoints(vector<OBColorPoint> &points, bool is_color)
+// Hands the pipeline to the acquisition thread, or takes it back. Framesets the thread is still
+// waiting for from before the change are dropped, they belong to the previous configuration.
+void Sensors::setPipelineStarted(bool state)
 {
-    m_curFrameSet = m_pipeline->waitForFrames(100);
+    {
+        std::lock_guard<std::mutex> lock(m_acquisitionMutex);
+        m_bIsPipelineStarted = state;
+        m_acquisitionPipeline = state ? m_pipeline : nullptr;
+        m_pipelineGeneration++;
+    }
+    m_acquisitionCond.notify_all();
+}
 
-    if (m_curFrameSet != nullptr && m_curFrameSet->depthFrame() != nullptr) {
-        if (m_curFrameSet->colorFrame() != nullptr && is_color) {
-            // point position value multiply depth value scale to convert uint to millimeter (for some devices, the default depth value uint is not millimeter)
-            auto depthValueScale = m_curFrameSet->depthFrame()->getValueScale();
-            ob::PointCloudFilter m_pointCloud;
-            m_pointCloud.setCameraParam(m_curCameraParams);
-            m_pointCloud.setPositionDataScaled(depthValueScale);
-            try {
-                // Generate a colored point cloud
-                m_pointCloud.setCreatePointFormat(OB_FORMAT_RGB_POINT);
-                std::shared_ptr<ob::Frame> frame = m_pointCloud.process(m_curFrameSet);
-
-                OBColorPoint* point = (OBColorPoint*)frame->data();
-                int pointsSize = frame->dataSize() / sizeof(OBColorPoint);
-                for (int i = 0; i < pointsSize; i++) {
-                    points.push_back(*point);
-                    point++;
+// Rebuild the config from the stream flags and restart the pipeline once.
+// Inside a reconfiguration the restart is only recorded and done by commitReconfiguration().
+void Sensors::restartPipeline()
+{
+    if (m_reconfigurationDepth > 0) {
+        m_bIsRestartPending = true;
+        return;
+    }
+
+    OB_TRACE_SCOPE("restartPipeline");
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    if (m_frameSource != nullptr) {
+        // No device, the source starts and stops its streams itself
+        for (int i = 0; i < STREAM_COUNT; i++) {
+            m_frameSource->setStreamEnabled((StreamIndex)i, isStreamOn((StreamIndex)i));
+        }
+    }
+    else if (m_bIsSensorStreaming && !m_bIsD2CAlignmentOn && !m_bisFrameSyncOn && !m_bIsPointCloudOn) {
+        // Only the sensors whose stream changed are touched, the others keep streaming
+        if (!m_bIsSensorDriven) {
+            stopPipeline();
+            m_bIsSensorDriven = true;
+        }
+        for (int i = 0; i < STREAM_COUNT; i++) {
+            updateSensorStream((StreamIndex)i);
+        }
+    }
+    else {
+        stopSensorStreams();
+        stopPipeline();
+        m_config->disableAllStream();
+        if (m_bIsColorOn)   m_config->enableStream(m_colorStreamProfile);
+        if (m_bIsDepthOn)   m_config->enableStream(m_depthStreamProfile);
+        if (m_bIsIROn)      m_config->enableStream(m_irStreamProfile);
+        if (m_bIsColorOn || m_bIsDepthOn || m_bIsIROn) startPipeline();
+    }
+    m_bIsRestartPending = false;
+    // Profiles or alignment may have changed, the point cloud needs the new parameters right away
+    m_bIsCameraParamValid = false;
+    if (m_bIsPointCloudOn) updateCameraParams();
+
+    m_lastRestartMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+    m_restartCount++;
+}
+
+// Start, stop or re-profile the sensor of one stream so it matches the stream flag and profile
+void Sensors::updateSensorStream(StreamIndex stream)
+{
+    bool bIsOn = isStreamOn(stream);
+    std::shared_ptr<ob::VideoStreamProfile> profile = stream == STREAM_COLOR ? m_colorStreamProfile : stream == STREAM_DEPTH ? m_depthStreamProfile : m_irStreamProfile;
+
+    if (m_streamSensors[stream] != nullptr && (!bIsOn || m_streamSensorProfiles[stream] != profile)) {
+        m_streamSensors[stream]->stop();
+        m_streamSensors[stream].reset();
+        m_streamSensorProfiles[stream].reset();
+    }
+    if (bIsOn && m_streamSensors[stream] == nullptr) {
+        OBSensorType sensorType = stream == STREAM_COLOR ? OB_SENSOR_COLOR : stream == STREAM_DEPTH ? OB_SENSOR_DEPTH : (m_bIsIRUnique ? OB_SENSOR_IR : OB_SENSOR_IR_LEFT);
+        std::shared_ptr<ob::Sensor> sensor = m_device->getSensor(sensorType);
+        // Runs on the sensor's own SDK thread, the publisher of this stream while it is sensor driven
+        sensor->start(profile, [this, stream](std::shared_ptr<ob::Frame> frame) {
+            if (frame != nullptr) publishFrame(stream, frame);
+        });
+        m_streamSensors[stream] = sensor;
+        m_streamSensorProfiles[stream] = profile;
+    }
+}
+
+void Sensors::stopSensorStreams()
+{
+    for (int i = 0; i < STREAM_COUNT; i++) {
+        if (m_streamSensors[i] == nullptr) continue;
+        try {
+            m_streamSensors[i]->stop();
+        }
+        catch (ob::Error& e) {
+            std::cerr << "stopSensorStreams: " << e.getName() << "\nargs:" << e.getArgs() << "\nmessage:" << e.getMessage() << "\ntype:" << e.getExceptionType() << std::endl;
+        }
+        m_streamSensors[i].reset();
+        m_streamSensorProfiles[i].reset();
+    }
+    m_bIsSensorDriven = false;
+}
+
+void Sensors::setSensorStreaming(bool state)
+{
+    std::lock_guard<std::mutex> lock(m_pipelineMutex);
+    if (m_bIsSensorStreaming == state) return;
+    m_bIsSensorStreaming = state;
+    try {
+        restartPipeline();
+    }
+    catch (ob::Error& e) {
+        std::cerr << "setSensorStreaming: " << e.getName() << "\nargs:" << e.getArgs() << "\nmessage:" << e.getMessage() << "\ntype:" << e.getExceptionType() << std::endl;
+    }
+}
+
+
+void Sensors::beginReconfiguration()
+{
+    std::lock_guard<std::mutex> lock(m_pipelineMutex);
+    m_reconfigurationDepth++;
+}
+
+bool Sensors::commitReconfiguration()
+{
+    std::lock_guard<std::mutex> lock(m_pipelineMutex);
+    if (m_reconfigurationDepth > 0) m_reconfigurationDepth--;
+    if (m_reconfigurationDepth > 0 || !m_bIsRestartPending) return true;
+
+    try {
+        restartPipeline();
+        return true;
+    }
+    catch (ob::Error& e) {
+        std::cerr << "commitReconfiguration: " << e.getName() << "\nargs:" << e.getArgs() << "\nmessage:" << e.getMessage() << "\ntype:" << e.getExceptionType() << std::endl;
+        m_bIsRestartPending = false;
+        return false;
+    }
+}
+
+void Sensors::setAcquisitionMode(AcquisitionMode mode, int ringDepth, FrameRingPolicy policy)
+{
+    // The acquisition thread reads the mode and consumes the ring, join it first
+    stopAcquisition();
+    {
+        std::lock_guard<std::mutex> lock(m_pipelineMutex);
+        try {
+            // The ring producer must be stopped before the ring is reset, even inside a reconfiguration
+            stopPipeline();
+            m_acquisitionMode = mode;
+            m_frameRingPolicy = policy;
+            m_frameRing.reset(ringDepth);
+            restartPipeline();
+        }
+        catch (ob::Error& e) {
+            std::cerr << "setAcquisitionMode: " << e.getName() << "\nargs:" << e.getArgs() << "\nmessage:" << e.getMessage() << "\ntype:" << e.getExceptionType() << std::endl;
+        }
+    }
+    startAcquisition();
+}
+
+void Sensors::startAcquisition()
+{
+    if (m_bIsAcquiring) return;
+
+    m_bIsAcquiring = true;
+    m_acquisitionThread = std::thread(&Sensors::acquisitionLoop, this);
+}
+
+void Sensors::stopAcquisition()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_acquisitionMutex);
+        m_bIsAcquiring = false;
+    }
+    m_acquisitionCond.notify_all();
+    if (m_acquisitionThread.joinable()) {
+        m_acquisitionThread.join();
+    }
+}
+
+void Sensors::acquisitionLoop()
+{
+    OB_TRACE_THREAD("acquisition");
+    // m_pipelineMutex is never taken here: waiting on the pipeline must not hold up the
+    // stream and profile changes made on the UI thread
+    while (true) {
+        std::shared_ptr<ob::Pipeline> pipeline;
+        uint32_t generation;
+        {
+            std::unique_lock<std::mutex> lock(m_acquisitionMutex);
+            if (m_acquisitionMode == ACQUISITION_CALLBACK) {
+                // The callback notifies without the lock, a wakeup lost in between costs at most 10 ms
+                m_acquisitionCond.wait_for(lock, std::chrono::milliseconds(10), [this]() {
+                    return !m_bIsAcquiring || (m_bIsPipelineStarted && !m_frameRing.empty());
+                });
+                if (!m_bIsAcquiring) break;
+                std::shared_ptr<ob::FrameSet> frameSet;
+                while (m_bIsPipelineStarted && m_frameRing.pop(frameSet, m_frameRingPolicy)) {
+                    publishFrameSet(frameSet);
                 }
+                continue;
             }
-            catch (std::exception& e) {
-                std::cout << "Get point cloud failed" << std::endl;
-            }
+
+            // Nothing is streaming through the pipeline while it is stopped, sleep until it starts
+            m_acquisitionCond.wait(lock, [this]() { return !m_bIsAcquiring || m_bIsPipelineStarted; });
+            if (!m_bIsAcquiring) break;
+            pipeline = m_acquisitionPipeline;
+            generation = m_pipelineGeneration;
         }
-        else {
-            const float max_dis = 5120.0f;
-            // point position value multiply depth value scale to convert uint to millimeter (for some devices, the default depth value uint is not millimeter)
-            auto depthValueScale = m_curFrameSet->depthFrame()->getValueScale();
-            ob::PointCloudFilter m_pointCloud;
-            m_pointCloud.setCameraParam(m_curCameraParams);
-            m_pointCloud.setPositionDataScaled(depthValueScale);
-            try {
-                // generate point cloud 
-                m_pointCloud.setCreatePointFormat(OB_FORMAT_POINT);
-                std::shared_ptr<ob::Frame> frame = m_pointCloud.process(m_curFrameSet);
-
-                OBPoint* point = (OBPoint*)frame->data();
-                int pointsSize = frame->dataSize() / sizeof(OBPoint);
-                for (int i = 0; i < pointsSize; i++) {
-                    OBColorPoint tmpPoint;
-                    tmpPoint.x = point->x;
-                    tmpPoint.y = point->y;
-                    tmpPoint.z = point->z;
-                    tmpPoint.r = point->z / max_dis * 255;
-                    tmpPoint.g = point->z / max_dis * 255;
-                    tmpPoint.b = point->z / max_dis * 255;
-                    points.push_back(tmpPoint);
-                    point++;
-                }
+
+        try {
+            std::shared_ptr<ob::FrameSet> frameSet;
+            {
+                OB_TRACE_SCOPE("waitForFrames");
+                frameSet = pipeline->waitForFrames(100);
             }
-            catch (std::exception& e) {
-                std::cout << "Get point cloud failed" << std::endl;
+            if (frameSet == nullptr) continue;
+
+            std::lock_guard<std::mutex> lock(m_acquisitionMutex);
+            if (generation == m_pipelineGeneration) publishFrameSet(frameSet);
+        }
+        catch (ob::Error& e) {
+            // Also seen when the pipeline is stopped while waiting
+            if (generation == m_pipelineGeneration) {
+                std::cerr << "acquisitionLoop: " << e.getName() << "\nargs:" << e.getArgs() << "\nmessage:" << e.getMessage() << "\ntype:" << e.getExceptionType() << std::endl;
             }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
         }
     }
-    else {
-        std::cout << "Get color frame or depth frame failed!" << std::endl;
-    }
 }
 
-void Sensors::readFrame()
+// Runs on the enumerator thread
+void Sensors::onDeviceChanged(const std::vector<std::string>& removed, const std::vector<std::string>& added)
 {
-    m_curFrameSet = m_pipeline->waitForFrames(100);
-    if (m_curFrameSet == nullptr) { return; }
+    std::lock_guard<std::mutex> lock(m_pipelineMutex);
+    if (m_serialNum.empty()) return;
 
-    std::unique_lock<std::mutex> lock(m_mutex, std::defer_lock);
-    if (lock.try_lock()) {
-        if (m_curFrameSet->colorFrame() != nullptr) {
-            m_curColorFrame = m_curFrameSet->colorFrame();
+    if (std::find(removed.begin(), removed.end(), m_serialNum) != removed.end()) {
+        printf("Device %s disconnected.\n", m_serialNum.c_str());
+        m_bIsDeviceLost = true;
+        stopSensorStreams();
+        try {
+            stopPipeline();
         }
-        if (m_curFrameSet->depthFrame() != nullptr) {
-            m_curDepthFrame = m_curFrameSet->depthFrame();
+        catch (ob::Error& e) {
+            // Expected, the device is already gone
         }
-        if (m_curFrameSet->irFrame() != nullptr || m_curFrameSet->getFrame(OB_FRAME_IR_LEFT) != nullptr) {
-            if (g_isIRUnique)
-                m_curIRFrame = m_curFrameSet->irFrame();
-            else
-                m_curIRFrame = m_curFrameSet->getFrame(OB_FRAME_IR_LEFT);
+    }
+    if (m_bIsDeviceLost && std::find(added.begin(), added.end(), m_serialNum) != added.end()) {
+        reconnectDevice();
+    }
+}
+
+// Look up the profile with the same resolution, format and frame rate in a list of the reconnected device
+static std::shared_ptr<ob::VideoStreamProfile> matchVideoProfile(const std::shared_ptr<ob::StreamProfileList>& profileList, const std::shared_ptr<ob::VideoStreamProfile>& profile)
+{
+    if (profileList == nullptr || profile == nullptr) return nullptr;
+    return profileList->getVideoStreamProfile(profile->width(), profile->height(), profile->format(), profile->fps());
+}
+
+// Open the replugged device again and restart the streams that were on when it was lost
+void Sensors::reconnectDevice()
+{
+    try {
+        std::shared_ptr<ob::DeviceList> deviceList = m_enumerator->getDeviceList();
+        if (deviceList == nullptr) return;
+        m_device = deviceList->getDeviceBySN(m_serialNum.c_str());
+        m_controlQueue.setDevice(m_device);
+        m_propertyCache.reset(m_device, getPropertyList(m_device));
+        sweepProperties();
+        m_pipeline = std::make_shared<ob::Pipeline>(m_device);
+        m_config = std::make_shared<ob::Config>();
+
+        // Profiles and sensors belong to the device they were queried from
+        stopSensorStreams();
+        m_colorStreamProfileList = m_pipeline->getStreamProfileList(OB_SENSOR_COLOR);
+        m_colorStreamProfile = matchVideoProfile(m_colorStreamProfileList, m_colorStreamProfile);
+        m_depthStreamProfileList = m_pipeline->getD2CDepthProfileList(m_colorStreamProfile, m_bIsSWD2C ? ALIGN_D2C_SW_MODE : ALIGN_D2C_HW_MODE);
+        m_depthStreamProfile = matchVideoProfile(m_depthStreamProfileList, m_depthStreamProfile);
+        m_irStreamProfileList = m_pipeline->getStreamProfileList(m_bIsIRUnique ? OB_SENSOR_IR : OB_SENSOR_IR_LEFT);
+        m_irStreamProfile = matchVideoProfile(m_irStreamProfileList, m_irStreamProfile);
+
+        if (m_bIsD2CAlignmentOn) m_config->setAlignMode(m_bIsSWD2C ? ALIGN_D2C_SW_MODE : ALIGN_D2C_HW_MODE);
+        if (m_bisFrameSyncOn) m_pipeline->enableFrameSync();
+        restartPipeline();
+
+        m_bIsDeviceLost = false;
+        printf("Device %s reconnected.\n", m_serialNum.c_str());
+    }
+    catch (ob::Error& e) {
+        std::cerr << "reconnectDevice: " << e.getName() << "\nargs:" << e.getArgs() << "\nmessage:" << e.getMessage() << "\ntype:" << e.getExceptionType() << std::endl;
+    }
+}
+
+// Copy the frame description into a slot; the slot keeps the SDK frame referenced so data stays valid
+static void fillFrameSlot(FrameSlot_S& slot, const std::shared_ptr<ob::Frame>& frame)
+{
+    auto videoFrame = frame->as<ob::VideoFrame>();
+    slot.holder = frame;
+    slot.data = (const uint8_t*)frame->data();
+    slot.dataSize = frame->dataSize();
+    slot.width = videoFrame->width();
+    slot.height = videoFrame->height();
+    slot.type = frame->type();
+    slot.format = frame->format();
+    slot.pixelBitSize = videoFrame->pixelAvailableBitSize();
+    slot.valueScale = (frame->type() == OB_FRAME_DEPTH) ? frame->as<ob::DepthFrame>()->getValueScale() : 1.0f;
+    slot.index = frame->index();
+    slot.timeStampUs = frame->timeStampUs();
+    slot.systemTimeStampUs = frame->systemTimeStampUs();
+}
+
+void Sensors::publishFrame(StreamIndex stream, const std::shared_ptr<ob::Frame>& frame)
+{
+    FrameSlot_S slot;
+    fillFrameSlot(slot, frame);
+    publishSlot(stream, slot);
+}
+
+// Common to SDK frames and frames of a FrameSource
+void Sensors::publishSlot(StreamIndex stream, const FrameSlot_S& slot)
+{
+    std::lock_guard<std::mutex> lock(m_publishMutex[stream]);
+    // A sensor callback may still be running after its stream was switched off and cleared
+    if (!isStreamOn(stream)) return;
+
+    uint64_t publishTimeUs = StreamStats::nowUs();
+    // A synchronized frameset may repeat the previous frame of a slower stream
+    uint64_t index = slot.index;
+    if (index != m_lastFrameIndex[stream]) {
+        if (m_lastFrameIndex[stream] != 0 && index > m_lastFrameIndex[stream] + 1) {
+            m_droppedFrames[stream] += index - m_lastFrameIndex[stream] - 1;
+        }
+        m_lastFrameIndex[stream] = index;
+        m_receivedFrames[stream]++;
+        m_receivedBytes[stream] += slot.dataSize;
+        m_streamStats[stream].onFrameReceived(slot.timeStampUs, slot.systemTimeStampUs, publishTimeUs);
+    }
+
+    m_frameBuffers[stream].back() = slot;
+    m_frameBuffers[stream].back().publishTimeUs = publishTimeUs;
+    m_frameBuffers[stream].publish();
+    if (m_frameArrivedCallback) m_frameArrivedCallback(stream);
+}
+
+void Sensors::clearFrame(StreamIndex stream)
+{
+    std::lock_guard<std::mutex> lock(m_publishMutex[stream]);
+    // Index restarts with the next stream start, that is not a drop
+    m_lastFrameIndex[stream] = 0;
+    // Nor is the device clock offset of the next session related to this one
+    m_streamStats[stream].reset();
+    m_frameBuffers[stream].back() = FrameSlot_S();
+    m_frameBuffers[stream].publish();
+    if (m_frameArrivedCallback) m_frameArrivedCallback(stream);
+}
+
+StreamCounters_S Sensors::getStreamCounters(StreamIndex stream)
+{
+    StreamCounters_S counters;
+    counters.received = m_receivedFrames[stream];
+    counters.receivedBytes = m_receivedBytes[stream];
+    counters.deviceDropped = m_droppedFrames[stream];
+    return counters;
+}
+
+void Sensors::publishFrameSet(const std::shared_ptr<ob::FrameSet>& frameSet)
+{
+    OB_TRACE_SCOPE("publishFrameSet");
+    // A stream switched off inside a pending reconfiguration keeps delivering until the commit
+    if (m_bIsColorOn && frameSet->colorFrame() != nullptr) {
+        publishFrame(STREAM_COLOR, frameSet->colorFrame());
+    }
+    if (m_bIsDepthOn && frameSet->depthFrame() != nullptr) {
+        publishFrame(STREAM_DEPTH, frameSet->depthFrame());
+    }
+    if (m_bIsIROn && (frameSet->irFrame() != nullptr || frameSet->getFrame(OB_FRAME_IR_LEFT) != nullptr)) {
+        if (m_bIsIRUnique)
+            publishFrame(STREAM_IR, frameSet->irFrame());
+        else
+            publishFrame(STREAM_IR, frameSet->getFrame(OB_FRAME_IR_LEFT));
+    }
+
+    // Whole frameset is handed to the point cloud thread, which skips any it could not keep up with
+    if (m_bIsPointCloudOn && frameSet->depthFrame() != nullptr) {
+        {
+            std::lock_guard<std::mutex> lock(m_pointCloudMutex);
+            m_pointCloudFrameSet = frameSet;
         }
+        m_pointCloudCond.notify_one();
     }
 }
@@ -2,35 +2,59 @@
 #include "libobsensor/ObSensor.hpp"
 #include "libobsensor/hpp/Error.hpp"
 #include "utils.hpp"
+#include "device_enumerator.h"
+#include "device_control.h"
+#include "property_cache.h"
+#include "stream_stats.h"
+#include "trace.h"
+#include "frame_source.h"
+#include "frame_ring.hpp"
+#include "triple_buffer.hpp"
 #include <thread>
 #include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <algorithm>
 #include <string.h>
 
 using namespace std;
 
-extern bool g_isIRUnique;
-
 class Sensors
 {
 public:
-    Sensors();
+    // Pass the same enumerator to every Sensors instance when several devices are opened at once
+    Sensors(std::shared_ptr<DeviceEnumerator> enumerator = nullptr);
     ~Sensors();
 
     int initCurSensor(const int deviceIndex);
+    // Stream from a FrameSource instead of a device; device controls are unavailable then
+    int initFrameSource(std::shared_ptr<FrameSource> source);
     void deinitCurSensor();
 
-    inline const std::shared_ptr<ob::DeviceList> getSensorList() { return m_deviceList; }   // Might not needed
+    inline const std::shared_ptr<ob::DeviceList> getSensorList() { return m_enumerator->getDeviceList(); }
+    inline std::shared_ptr<DeviceEnumerator> getDeviceEnumerator() { return m_enumerator; }
+    // The opened device was unplugged; streaming resumes on its own once it is connected again
+    inline bool isDeviceLost() { return m_bIsDeviceLost; }
     void getCurSensorInfo(SensorInfo_S& sensorInfo);
     std::vector<std::string>* getSensorStrList();
     std::string getFirmwareVer();
     std::string getSDKVer();
 
     // ##### Device Control #####
+    // Property setters only queue the write and getters never wait for it; getControlStatus() tells when it is done
+    inline ControlStatus getControlStatus(OBPropertyID id) { return m_controlQueue.getStatus(id); }
+    // Property reads served from the snapshot and reads that went to the device
+    inline uint64_t getPropertyCacheHits() { return m_propertyCache.getHitCount(); }
+    inline uint64_t getPropertyCacheMisses() { return m_propertyCache.getMissCount(); }
     bool toggleD2CAlignment(int type);
 	bool toggleFrameSync();
-    bool setLaserEnable(bool state);
+    void setLaserEnable(bool state);
     int getDepthPrecisionLevel();
-    bool setDepthPrecisionLevel(int level);
+    void setDepthPrecisionLevel(int level);
+    // Millimeters per depth unit of the level the device last accepted
+    inline float getDepthValueScale() { return m_depthValueScale; }
 
     OBCameraParam getCameraParams();
 
@@ -44,9 +68,14 @@ public:
     inline const std::shared_ptr<ob::VideoStreamProfile> getDepthVideoMode()     { return m_depthStreamProfile; }
     inline const std::shared_ptr<ob::VideoStreamProfile> getIRVideoMode()        { return m_irStreamProfile; }
 
-    inline const std::shared_ptr<ob::Frame> getCurColorFrame()  { return m_curColorFrame; }
-    inline const std::shared_ptr<ob::Frame> getCurDepthFrame()  { return m_curDepthFrame; }
-    inline const std::shared_ptr<ob::Frame> getCurIRFrame()     { return m_curIRFrame; }
+    // Latest frame per stream, single reader only: call updateFrame() then read getFrame()
+    inline bool updateFrame(StreamIndex stream)                 { return m_frameBuffers[stream].update(); }
+    inline const FrameSlot_S& getFrame(StreamIndex stream)      { return m_frameBuffers[stream].front(); }
+    // Called on the publishing thread after a stream's frame slot changed; set before streaming starts
+    inline void setFrameArrivedCallback(std::function<void(StreamIndex)> callback) { m_frameArrivedCallback = callback; }
+    StreamCounters_S getStreamCounters(StreamIndex stream);
+    // Frame timing, fed on publish here and on conversion by the Service
+    inline StreamStats& getStreamStats(StreamIndex stream) { return m_streamStats[stream]; }
 
     void setColorVideoMode(int index);
     void setDepthVideoMode(int index);
@@ -56,7 +85,33 @@ public:
     void setDepthVideoMode(int width, int height, int fps);
     void setIRVideoMode(int width, int height, int fps);
 
-    void readFrame();
+    // ##### Reconfiguration #####
+    // Stream, profile and alignment changes made between begin and commit are applied with a
+    // single pipeline restart at the commit; calls may nest, the outermost commit applies them.
+    void beginReconfiguration();
+    bool commitReconfiguration();
+    inline double getLastRestartMs() { return m_lastRestartMs; }
+    inline uint32_t getRestartCount() { return m_restartCount; }
+    // Time initCurSensor took to open the device and enumerate its profiles
+    inline double getLastInitMs() { return m_lastInitMs; }
+
+    // ##### Per Sensor Streaming #####
+    // Streams run on their own ob::Sensor, so starting or stopping one never interrupts the others.
+    // Frame sync, D2C and the point cloud need framesets, while any is on the pipeline drives all streams.
+    void setSensorStreaming(bool state);
+    inline bool getSensorStreaming() { return m_bIsSensorStreaming; }
+    inline bool isSensorDriven() { return m_bIsSensorDriven; }
+
+    // ##### Acquisition #####
+    // Frames are published on a dedicated thread, which either pulls them from the pipeline or
+    // drains the ring filled by the pipeline callback; the caller's thread is never involved.
+    void startAcquisition();
+    void stopAcquisition();
+    // In ACQUISITION_CALLBACK mode the pipeline pushes framesets into a ring of ringDepth entries
+    void setAcquisitionMode(AcquisitionMode mode, int ringDepth = 4, FrameRingPolicy policy = FRAME_RING_LATEST_ONLY);
+    inline AcquisitionMode getAcquisitionMode() { return m_acquisitionMode; }
+    inline FrameRingPolicy getFrameRingPolicy() { return m_frameRingPolicy; }
+    inline FrameRingStats_S getFrameRingStats() { return m_frameRing.getStats(); }
 
     //color
     int startCurColor();
@@ -98,6 +153,7 @@ public:
 	void toggleMDCA(bool state);
     std::vector<std::string>* getCurDepthWorkModeStrList() { return &m_deviceDepthModeStringList; }
     int getCurDepthWorkMode() { return m_curDeviceDepthMode; }
+    // False for a mode out of the list, the switch itself is queued
     bool setDepthWorkMode(int mode);
 
     //ir
@@ -119,24 +175,77 @@ public:
     void setIRGainValue(int value);
 
     // Point Cloud
+    // Produced on its own thread from the newest frameset while on. Single reader only: call
+    // updatePointCloud() then read getPointCloud()
     void togglePointCloud();
-    void generatePointCloudPoints(vector<OBColorPoint> &points, bool is_color);
+    inline void setPointCloudColor(bool state) { m_bIsPointCloudColor = state; }
+    inline bool updatePointCloud() { return m_pointClouds.update(); }
+    inline const PointCloudSlot_S& getPointCloud() { return m_pointClouds.front(); }
 
 private:
     std::vector<OBPropertyItem> getPropertyList(std::shared_ptr<ob::Device> device);
+    std::shared_ptr<ob::Device> getDevice();
+    void sweepProperties();
+    void acquisitionLoop();
+    void startPipeline();
+    void stopPipeline();            // m_pipelineMutex must be held
+    void setPipelineStarted(bool state);
+    void restartPipeline();         // m_pipelineMutex must be held
+    void updateCameraParams();      // m_pipelineMutex must be held
+    inline bool isStreamOn(StreamIndex stream) { return stream == STREAM_COLOR ? m_bIsColorOn : stream == STREAM_DEPTH ? m_bIsDepthOn : m_bIsIROn; }
+    void updateSensorStream(StreamIndex stream);
+    void stopSensorStreams();
+    void publishFrameSet(const std::shared_ptr<ob::FrameSet>& frameSet);
+    void publishFrame(StreamIndex stream, const std::shared_ptr<ob::Frame>& frame);
+    void publishSlot(StreamIndex stream, const FrameSlot_S& slot);
+    void clearFrame(StreamIndex stream);
+    void onDeviceChanged(const std::vector<std::string>& removed, const std::vector<std::string>& added);
+    void reconnectDevice();         // m_pipelineMutex must be held
+    void pointCloudLoop();
+    void stopPointCloud();
 
 private:
-    std::mutex m_mutex;
-    std::shared_ptr<ob::Context> m_context = std::make_shared<ob::Context>();
-    std::shared_ptr<ob::Pipeline> m_pipeline = std::make_shared<ob::Pipeline>();
+    std::mutex m_pipelineMutex;     // serializes pipeline start/stop and reconfiguration
+    std::thread m_acquisitionThread;
+    std::atomic<bool> m_bIsAcquiring{ false };
+    // The acquisition thread waits on m_acquisitionCond until the pipeline is started and
+    // publishes only framesets of the current generation, both under m_acquisitionMutex.
+    // It is also the consumer of m_frameRing, which is only popped or cleared under that mutex.
+    std::mutex m_acquisitionMutex;
+    std::condition_variable m_acquisitionCond;
+    bool m_bIsPipelineStarted = false;
+    std::shared_ptr<ob::Pipeline> m_acquisitionPipeline;
+    std::atomic<uint32_t> m_pipelineGeneration{ 0 };
+    AcquisitionMode m_acquisitionMode = ACQUISITION_POLLING;
+    FrameRingPolicy m_frameRingPolicy = FRAME_RING_LATEST_ONLY;
+    FrameRing<std::shared_ptr<ob::FrameSet>> m_frameRing;
+    std::shared_ptr<DeviceEnumerator> m_enumerator;
+    int m_deviceListenerId = -1;
+    std::atomic<bool> m_bIsDeviceLost{ false };
+    std::string m_serialNum;                        // of the opened device, used to find it again after a replug
+    std::shared_ptr<ob::Pipeline> m_pipeline;     // Created for the selected device in initCurSensor()
     std::shared_ptr<ob::Config> m_config;
-    std::shared_ptr<ob::DeviceList> m_deviceList;
+    int m_reconfigurationDepth = 0;                 // guarded by m_pipelineMutex
+    bool m_bIsRestartPending = false;
+    bool m_bIsSensorStreaming = false;
+    std::atomic<bool> m_bIsSensorDriven{ false };   // streams currently run on sensors instead of the pipeline
+    std::shared_ptr<ob::Sensor> m_streamSensors[STREAM_COUNT];
+    std::shared_ptr<ob::VideoStreamProfile> m_streamSensorProfiles[STREAM_COUNT];
+    std::atomic<double> m_lastRestartMs{ 0.0 };
+    std::atomic<uint32_t> m_restartCount{ 0 };
+    std::atomic<double> m_lastInitMs{ 0.0 };
     std::shared_ptr<ob::Device> m_device = nullptr;
-    std::vector<std::string> m_deviceStringList;
+    std::shared_ptr<FrameSource> m_frameSource;     // set instead of a device by initFrameSource()
+    DevicePropertyCache m_propertyCache;            // declared before the queue, its callback writes here
+    std::atomic<float> m_depthValueScale{ 1.0f };   // as well
+    std::atomic<int> m_curDeviceDepthMode{ 0 };     // as well, after a work mode switch
+    DeviceControlQueue m_controlQueue;
+    std::vector<std::string> m_deviceStringList;    // Copy of the enumerator list, refreshed when it changed
+    uint32_t m_deviceListGeneration = 0;
     std::vector<std::string> m_deviceDepthModeStringList;
-    int m_curDeviceDepthMode;
 
     OBCameraParam m_curCameraParams;
+    bool m_bIsCameraParamValid = false;     // false until read from the pipeline, and again after each restart
 
     std::shared_ptr<ob::StreamProfileList> m_colorStreamProfileList;
     std::shared_ptr<ob::StreamProfileList> m_depthStreamProfileList;
@@ -146,20 +255,33 @@ private:
     std::shared_ptr<ob::VideoStreamProfile> m_depthStreamProfile;
     std::shared_ptr<ob::VideoStreamProfile> m_irStreamProfile;
 
-    std::shared_ptr<ob::Frame> m_curColorFrame;
-    std::shared_ptr<ob::Frame> m_curDepthFrame;
-    std::shared_ptr<ob::Frame> m_curIRFrame;
-
-    std::shared_ptr<ob::FrameSet> m_curFrameSet;
+    // Written by whoever publishes framesets (acquisition thread or ring consumer)
+    TripleBuffer<FrameSlot_S> m_frameBuffers[STREAM_COUNT];
+    std::function<void(StreamIndex)> m_frameArrivedCallback;
+    std::mutex m_publishMutex[STREAM_COUNT];        // sensor callbacks and clearFrame() may both write a stream
+    // Throughput counters, written by the frame publisher only
+    std::atomic<uint64_t> m_receivedFrames[STREAM_COUNT];
+    std::atomic<uint64_t> m_receivedBytes[STREAM_COUNT];
+    std::atomic<uint64_t> m_droppedFrames[STREAM_COUNT];
+    uint64_t m_lastFrameIndex[STREAM_COUNT] = { 0, 0, 0 };
+    StreamStats m_streamStats[STREAM_COUNT];
 
     bool m_bIsD2CAlignmentOn = false;
     bool m_bIsSWD2C = false;
+    bool m_bIsIRUnique = true;      // false on dual IR devices, which stream IR left instead
 	bool m_bisFrameSyncOn = false;
 
-    bool m_bIsDepthOn = false;
-    bool m_bIsColorOn = false;
-    bool m_bIsIROn = false;
-    bool m_bIsPointCloudOn = false; 
-    //ob::PointCloudFilter m_pointCloud;
-    vector<OBColorPoint> m_points;
+    std::atomic<bool> m_bIsDepthOn{ false };
+    std::atomic<bool> m_bIsColorOn{ false };
+    std::atomic<bool> m_bIsIROn{ false };
+    std::atomic<bool> m_bIsPointCloudOn{ false };
+    std::atomic<bool> m_bIsPointCloudColor{ false };
+    std::thread m_pointCloudThread;
+    std::mutex m_pointCloudMutex;                   // guards the pending frameset and camera parameters below
+    std::condition_variable m_pointCloudCond;
+    std::shared_ptr<ob::FrameSet> m_pointCloudFrameSet;     // newest frameset not yet turned into points
+    OBCameraParam m_pointCloudParams;
+    uint32_t m_pointCloudParamVersion = 0;          // bumped on every camera parameter update
+    // Written by the point cloud thread, read by whoever calls updatePointCloud()
+    TripleBuffer<PointCloudSlot_S> m_pointClouds;
 };
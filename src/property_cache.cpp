@@ -0,0 +1,154 @@
+#include "property_cache.h"
+#include <algorithm>
+#include <string.h>
+#include <iostream>
+
+void DevicePropertyCache::reset(std::shared_ptr<ob::Device> device, const std::vector<OBPropertyItem>& propertyList)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_device = device;
+    m_entries.clear();
+    for (size_t i = 0; i < propertyList.size(); i++) {
+        const OBPropertyItem& item = propertyList[i];
+        if (item.type != OB_INT_PROPERTY && item.type != OB_BOOL_PROPERTY) continue;
+
+        PropertyEntry_S entry;
+        entry.id = item.id;
+        entry.type = item.type;
+        entry.permission = item.permission;
+        entry.isValid = false;
+        memset(&entry.range, 0, sizeof(entry.range));
+        m_entries.push_back(entry);
+    }
+    std::sort(m_entries.begin(), m_entries.end(), [](const PropertyEntry_S& a, const PropertyEntry_S& b) { return a.id < b.id; });
+    m_bIsSweepPending = true;
+    m_sweepCond.notify_all();
+}
+
+void DevicePropertyCache::sweep(std::shared_ptr<ob::Device> device)
+{
+    // One entry per lock, reads of entries already swept are served meanwhile
+    for (size_t i = 0;; i++) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_device != device || device == nullptr) return;
+        if (i >= m_entries.size()) break;
+        if (m_entries[i].isValid) continue;
+        try {
+            readEntry(m_entries[i]);
+        }
+        catch (ob::Error& e) {
+            // Left invalid, the first read of it tries again
+            std::cerr << "DevicePropertyCache::sweep: " << e.getName() << "\nargs:" << e.getArgs() << "\nmessage:" << e.getMessage() << "\ntype:" << e.getExceptionType() << std::endl;
+        }
+        m_sweepCond.notify_all();
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_bIsSweepPending = false;
+    m_sweepCond.notify_all();
+}
+
+bool DevicePropertyCache::isPropertySupported(OBPropertyID id, OBPermissionType permission)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    PropertyEntry_S* entry = findEntry(id);
+    return entry != NULL && (entry->permission & permission) == permission;
+}
+
+bool DevicePropertyCache::getBoolProperty(OBPropertyID id)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    PropertyEntry_S* entry = waitForSweep(lock, id);
+    if (entry == NULL) {
+        // Not part of the snapshot, read through
+        m_missCount++;
+        return m_device->getBoolProperty(id);
+    }
+    if (!entry->isValid) readEntry(*entry);
+    else m_hitCount++;
+    return entry->range.cur != 0;
+}
+
+int DevicePropertyCache::getIntProperty(OBPropertyID id)
+{
+    return getIntPropertyRange(id).cur;
+}
+
+OBIntPropertyRange DevicePropertyCache::getIntPropertyRange(OBPropertyID id)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    PropertyEntry_S* entry = waitForSweep(lock, id);
+    if (entry == NULL) {
+        m_missCount++;
+        return m_device->getIntPropertyRange(id);
+    }
+    if (!entry->isValid) readEntry(*entry);
+    else m_hitCount++;
+    return entry->range;
+}
+
+void DevicePropertyCache::store(OBPropertyID id, int value)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    PropertyEntry_S* entry = findEntry(id);
+    if (entry == NULL) return;
+    if (entry->type == OB_BOOL_PROPERTY) {
+        entry->range.cur = value != 0 ? 1 : 0;
+        entry->range.min = 0;
+        entry->range.max = 1;
+        entry->range.step = 1;
+        entry->isValid = true;
+    }
+    else if (entry->isValid) {
+        entry->range.cur = value;
+    }
+}
+
+void DevicePropertyCache::invalidate(OBPropertyID id)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    PropertyEntry_S* entry = findEntry(id);
+    if (entry != NULL) entry->isValid = false;
+}
+
+void DevicePropertyCache::invalidateAll()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (size_t i = 0; i < m_entries.size(); i++) {
+        m_entries[i].isValid = false;
+    }
+}
+
+// Entry of id once the sweep has read it or is over; the table may have been reset while waiting
+DevicePropertyCache::PropertyEntry_S* DevicePropertyCache::waitForSweep(std::unique_lock<std::mutex>& lock, OBPropertyID id)
+{
+    PropertyEntry_S* entry = findEntry(id);
+    while (entry != NULL && !entry->isValid && m_bIsSweepPending) {
+        m_sweepCond.wait(lock);
+        entry = findEntry(id);
+    }
+    return entry;
+}
+
+DevicePropertyCache::PropertyEntry_S* DevicePropertyCache::findEntry(OBPropertyID id)
+{
+    auto it = std::lower_bound(m_entries.begin(), m_entries.end(), id, [](const PropertyEntry_S& entry, OBPropertyID value) { return entry.id < value; });
+    return (it != m_entries.end() && it->id == id) ? &(*it) : NULL;
+}
+
+// Mutex must be held; throws ob::Error like the device read it wraps
+void DevicePropertyCache::readEntry(PropertyEntry_S& entry)
+{
+    m_missCount++;
+    if (entry.type == OB_INT_PROPERTY) {
+        // Value and range come back with the same transfer
+        entry.range = m_device->getIntPropertyRange(entry.id);
+    }
+    else {
+        entry.range.cur = m_device->getBoolProperty(entry.id) ? 1 : 0;
+        entry.range.min = 0;
+        entry.range.max = 1;
+        entry.range.step = 1;
+    }
+    entry.isValid = true;
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include "libobsensor/ObSensor.hpp"
+#include "libobsensor/hpp/Error.hpp"
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <vector>
+
+// Table of the device's int and bool properties, filled by one sweep over all of them after the device
+// was opened. Reads mirror the ob::Device API but are served from the table; a read arriving during
+// the sweep waits for it instead of issuing its own transfer, and an entry goes back to the device only
+// after it was invalidated. Thread safe.
+class DevicePropertyCache
+{
+public:
+    // Drop the old table and list the properties of device; sweep() must follow, reads wait for it
+    void reset(std::shared_ptr<ob::Device> device, const std::vector<OBPropertyItem>& propertyList);
+    // Read every listed property of device, off the UI thread; does nothing once the table was reset to another device
+    void sweep(std::shared_ptr<ob::Device> device);
+
+    bool isPropertySupported(OBPropertyID id, OBPermissionType permission);
+    bool getBoolProperty(OBPropertyID id);
+    int getIntProperty(OBPropertyID id);
+    OBIntPropertyRange getIntPropertyRange(OBPropertyID id);
+
+    // The device accepted value, no need to read it back; an int never read stays invalid, its range is unknown
+    void store(OBPropertyID id, int value);
+    void invalidate(OBPropertyID id);
+    void invalidateAll();
+
+    // Reads served from the table and reads that went to the device
+    inline uint64_t getHitCount() { return m_hitCount; }
+    inline uint64_t getMissCount() { return m_missCount; }
+
+private:
+    typedef struct PropertyEntry_S {
+        OBPropertyID id;
+        OBPropertyType type;
+        OBPermissionType permission;
+        bool isValid;               // range.cur holds the current value of int and bool properties
+        OBIntPropertyRange range;
+    } PropertyEntry_S;
+
+    PropertyEntry_S* findEntry(OBPropertyID id);
+    PropertyEntry_S* waitForSweep(std::unique_lock<std::mutex>& lock, OBPropertyID id);
+    void readEntry(PropertyEntry_S& entry);
+
+private:
+    std::mutex m_mutex;
+    std::condition_variable m_sweepCond;
+    bool m_bIsSweepPending = false;
+    std::shared_ptr<ob::Device> m_device;
+    std::vector<PropertyEntry_S> m_entries;     // sorted by id
+    std::atomic<uint64_t> m_hitCount{ 0 };
+    std::atomic<uint64_t> m_missCount{ 0 };
+};
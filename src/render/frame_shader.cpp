@@ -0,0 +1,235 @@
+#include "frame_shader.h"
+#include "trace.h"
+#include <stdio.h>
+#include <algorithm>
+
+// One triangle covering the viewport; fragments address the source by their pixel position,
+// so row 0 of the target is written from row 0 of the frame
+static const char* s_vertexShader =
+    "#version 130\n"
+    "void main() {\n"
+    "    vec2 position = vec2(float((gl_VertexID << 1) & 2), float(gl_VertexID & 2));\n"
+    "    gl_Position = vec4(position * 2.0 - 1.0, 0.0, 1.0);\n"
+    "}\n";
+
+// Same mapping as DepthColorLut: 0 and distances outside the range are invalid
+static const char* s_depthShader =
+    "#version 130\n"
+    "uniform sampler2D source;\n"
+    "uniform sampler1D palette;\n"
+    "uniform float valueScale;\n"
+    "uniform vec2 range;\n"
+    "uniform float span;\n"
+    "uniform int isWrapped;\n"
+    "uniform vec3 invalidColor;\n"
+    "out vec4 color;\n"
+    "void main() {\n"
+    "    float value = floor(texelFetch(source, ivec2(gl_FragCoord.xy), 0).r * 65535.0 + 0.5);\n"
+    "    float distance = value * valueScale;\n"
+    "    if (value == 0.0 || distance < range.x || distance > range.y) {\n"
+    "        color = vec4(invalidColor, 1.0);\n"
+    "        return;\n"
+    "    }\n"
+    "    float position = (distance - range.x) / span;\n"
+    "    if (isWrapped != 0) position = fract(position);\n"
+    "    int index = int(min(floor(position * 255.0 + 0.5), 255.0));\n"
+    "    color = vec4(texelFetch(palette, index, 0).rgb, 1.0);\n"
+    "}\n";
+
+// Same as convertScaleAbs in convertIRFrame()
+static const char* s_irShader =
+    "#version 130\n"
+    "uniform sampler2D source;\n"
+    "uniform float maxValue;\n"
+    "uniform float scale;\n"
+    "out vec4 color;\n"
+    "void main() {\n"
+    "    float value = texelFetch(source, ivec2(gl_FragCoord.xy), 0).r * maxValue;\n"
+    "    float gray = min(floor(value * scale + 0.5), 255.0) / 255.0;\n"
+    "    color = vec4(gray, gray, gray, 1.0);\n"
+    "}\n";
+
+// One texel per pixel holding Y and alternately U and V (YUYV) or the other way round (UYVY).
+// BT.601 limited range, as cvtColor
+static const char* s_yuvShader =
+    "#version 130\n"
+    "uniform sampler2D source;\n"
+    "uniform int isUYVY;\n"
+    "out vec4 color;\n"
+    "void main() {\n"
+    "    ivec2 pos = ivec2(gl_FragCoord.xy);\n"
+    "    vec2 texel = texelFetch(source, pos, 0).rg;\n"
+    "    vec2 left = texelFetch(source, ivec2(pos.x & ~1, pos.y), 0).rg;\n"
+    "    vec2 right = texelFetch(source, ivec2(pos.x | 1, pos.y), 0).rg;\n"
+    "    float y = isUYVY != 0 ? texel.g : texel.r;\n"
+    "    float u = isUYVY != 0 ? left.r : left.g;\n"
+    "    float v = isUYVY != 0 ? right.r : right.g;\n"
+    "    y = 1.164 * (y * 255.0 - 16.0);\n"
+    "    u = u * 255.0 - 128.0;\n"
+    "    v = v * 255.0 - 128.0;\n"
+    "    vec3 rgb = vec3(y + 1.596 * v, y - 0.813 * v - 0.391 * u, y + 2.018 * u);\n"
+    "    color = vec4(clamp(rgb / 255.0, 0.0, 1.0), 1.0);\n"
+    "}\n";
+
+bool FrameShader::init()
+{
+    if (mIsReady) return true;
+    if (!gl.hasShaders) return false;
+
+    static const char* sources[SHADER_COUNT] = { s_depthShader, s_irShader, s_yuvShader };
+    for (int i = 0; i < SHADER_COUNT; i++) {
+        mPrograms[i] = linkProgram(s_vertexShader, sources[i]);
+        if (mPrograms[i] == 0) {
+            release();
+            return false;
+        }
+    }
+    gl.genFramebuffers(1, &mFramebuffer);
+    gl.genVertexArrays(1, &mVertexArray);
+    mIsReady = true;
+    return true;
+}
+
+void FrameShader::release()
+{
+    if (!gl.hasShaders) return;
+    for (int i = 0; i < SHADER_COUNT; i++) {
+        if (mPrograms[i] != 0) gl.deleteProgram(mPrograms[i]);
+        if (mSources[i].id != 0) glDeleteTextures(1, &mSources[i].id);
+        mPrograms[i] = 0;
+        mSources[i] = SourceTexture_S();
+    }
+    if (mPalette != 0) glDeleteTextures(1, &mPalette);
+    if (mFramebuffer != 0) gl.deleteFramebuffers(1, &mFramebuffer);
+    if (mVertexArray != 0) gl.deleteVertexArrays(1, &mVertexArray);
+    mPalette = mFramebuffer = mVertexArray = 0;
+    mPaletteColormap = DEPTH_COLORMAP_COUNT;
+    mIsReady = false;
+}
+
+void FrameShader::uploadSource(SourceTexture_S& source, const cv::Mat& raw, GLint internalFormat, GLenum format, GLenum type)
+{
+    if (source.id == 0) glGenTextures(1, &source.id);
+    glBindTexture(GL_TEXTURE_2D, source.id);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    // Read with texelFetch, but a texture without mipmaps still needs a non-mipmap filter to be complete
+    if (source.width != raw.cols || source.height != raw.rows || source.internalFormat != internalFormat) {
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, raw.cols, raw.rows, 0, format, type, raw.data);
+        source.width = raw.cols;
+        source.height = raw.rows;
+        source.internalFormat = internalFormat;
+    }
+    else {
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, raw.cols, raw.rows, format, type, raw.data);
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
+void FrameShader::updatePalette(DepthColormapType colormap)
+{
+    if (mPalette != 0 && mPaletteColormap == colormap) return;
+    cv::Mat palette = depthColormapPalette(colormap);
+    if (mPalette == 0) glGenTextures(1, &mPalette);
+    glBindTexture(GL_TEXTURE_1D, mPalette);
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage1D(GL_TEXTURE_1D, 0, GL_RGB, palette.cols, 0, GL_RGB, GL_UNSIGNED_BYTE, palette.data);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_1D, 0);
+    mPaletteColormap = colormap;
+}
+
+bool FrameShader::render(const ImageSlot_S& slot, const DepthColorParam_S& depthParam, StreamTexture& target)
+{
+    OB_TRACE_SCOPE("FrameShader::render");
+    const FrameSlot_S& frame = slot.frame;
+    const cv::Mat& raw = slot.raw;
+    if (!mIsReady || raw.empty()) return false;
+
+    ShaderType shader;
+    if (raw.type() == CV_8UC2) shader = SHADER_YUV422;
+    else if (frame.type == OB_FRAME_DEPTH && raw.type() == CV_16UC1) shader = SHADER_DEPTH;
+    else if (is_ir_frame(frame.type) && (raw.type() == CV_16UC1 || raw.type() == CV_8UC1)) shader = SHADER_IR;
+    else return false;
+
+    GLuint program = mPrograms[shader];
+    SourceTexture_S& source = mSources[shader];
+    if (raw.type() == CV_16UC1) uploadSource(source, raw, GL_R16, GL_RED, GL_UNSIGNED_SHORT);
+    else if (raw.type() == CV_8UC1) uploadSource(source, raw, GL_R8, GL_RED, GL_UNSIGNED_BYTE);
+    else uploadSource(source, raw, GL_RG8, GL_RG, GL_UNSIGNED_BYTE);
+    if (shader == SHADER_DEPTH) updatePalette(depthParam.colormap);
+    target.allocate(raw.cols, raw.rows);
+
+    // Leave the state as found, the UI and the point cloud view draw right after
+    GLint lastViewport[4], lastProgram, lastFramebuffer, lastVertexArray, lastActiveTexture;
+    glGetIntegerv(GL_VIEWPORT, lastViewport);
+    glGetIntegerv(GL_CURRENT_PROGRAM, &lastProgram);
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &lastFramebuffer);
+    glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &lastVertexArray);
+    glGetIntegerv(GL_ACTIVE_TEXTURE, &lastActiveTexture);
+    GLboolean isBlend = glIsEnabled(GL_BLEND);
+    GLboolean isScissor = glIsEnabled(GL_SCISSOR_TEST);
+    GLboolean isDepthTest = glIsEnabled(GL_DEPTH_TEST);
+    glDisable(GL_BLEND);
+    glDisable(GL_SCISSOR_TEST);
+    glDisable(GL_DEPTH_TEST);
+
+    gl.bindFramebuffer(GL_FRAMEBUFFER, mFramebuffer);
+    gl.framebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target.id(), 0);
+    bool isComplete = gl.checkFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    if (isComplete) {
+        glViewport(0, 0, raw.cols, raw.rows);
+        gl.useProgram(program);
+        gl.activeTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, source.id);
+        gl.uniform1i(gl.getUniformLocation(program, "source"), 0);
+
+        if (shader == SHADER_DEPTH) {
+            bool isWrapped = depthParam.colormap == DEPTH_COLORMAP_WRAPPED;
+            float low = (float)depthParam.dispRange[0];
+            float high = (float)depthParam.dispRange[1];
+            gl.activeTexture(GL_TEXTURE1);
+            glBindTexture(GL_TEXTURE_1D, mPalette);
+            gl.uniform1i(gl.getUniformLocation(program, "palette"), 1);
+            gl.uniform1f(gl.getUniformLocation(program, "valueScale"), frame.valueScale);
+            gl.uniform2f(gl.getUniformLocation(program, "range"), low, high);
+            gl.uniform1f(gl.getUniformLocation(program, "span"), isWrapped ? (float)DEPTH_WRAP_MM : std::max(high - low, 1.0f));
+            gl.uniform1i(gl.getUniformLocation(program, "isWrapped"), isWrapped ? 1 : 0);
+            gl.uniform3f(gl.getUniformLocation(program, "invalidColor"), depthParam.invalidColor[0] / 255.0f,
+                depthParam.invalidColor[1] / 255.0f, depthParam.invalidColor[2] / 255.0f);
+        }
+        else if (shader == SHADER_IR) {
+            bool isY16 = raw.type() == CV_16UC1;
+            gl.uniform1f(gl.getUniformLocation(program, "maxValue"), isY16 ? 65535.0f : 255.0f);
+            gl.uniform1f(gl.getUniformLocation(program, "scale"), isY16 ? 1.0f / (float)(1 << std::max(frame.pixelBitSize - 8, 0)) : 1.0f);
+        }
+        else {
+            gl.uniform1i(gl.getUniformLocation(program, "isUYVY"), frame.format == OB_FORMAT_UYVY ? 1 : 0);
+        }
+
+        gl.bindVertexArray(mVertexArray);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+    }
+    else {
+        printf("[ERR] Frame shader target incomplete, using the CPU conversion\n");
+        mIsReady = false;
+    }
+
+    gl.framebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 0, 0);
+    gl.bindFramebuffer(GL_FRAMEBUFFER, (GLuint)lastFramebuffer);
+    gl.bindVertexArray((GLuint)lastVertexArray);
+    gl.useProgram((GLuint)lastProgram);
+    gl.activeTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_1D, 0);
+    gl.activeTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    gl.activeTexture((GLenum)lastActiveTexture);
+    glViewport(lastViewport[0], lastViewport[1], lastViewport[2], lastViewport[3]);
+    if (isBlend) glEnable(GL_BLEND);
+    if (isScissor) glEnable(GL_SCISSOR_TEST);
+    if (isDepthTest) glEnable(GL_DEPTH_TEST);
+    return isComplete;
+}
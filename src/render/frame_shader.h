@@ -0,0 +1,47 @@
+#pragma once
+#include "gl_functions.h"
+#include "stream_texture.h"
+#include "frame_convert.h"
+
+// Converts raw frames to RGB on the GPU for display: depth range and colormap, IR bit depth
+// scaling and packed YUV 4:2:2. The frame is uploaded as it arrived, as a one or two channel
+// texture, and a GLSL 1.30 fragment shader writes the RGB result into the stream's texture
+// through a framebuffer object. Needs GL 3.0, which Mesa's software rasterizers provide too.
+class FrameShader
+{
+public:
+    // Call with the context current; false leaves it unusable and frames are converted on the CPU
+    bool init();
+    void release();
+    inline bool isReady() const { return mIsReady; }
+
+    // Frames left raw by Service, see wrapRawFrame(); false for anything else
+    bool render(const ImageSlot_S& slot, const DepthColorParam_S& depthParam, StreamTexture& target);
+
+private:
+    typedef enum {
+        SHADER_DEPTH = 0,
+        SHADER_IR = 1,
+        SHADER_YUV422 = 2,
+        SHADER_COUNT
+    } ShaderType;
+
+    typedef struct SourceTexture_S {
+        GLuint id = 0;
+        int width = 0;
+        int height = 0;
+        GLint internalFormat = 0;
+    } SourceTexture_S;
+
+    void uploadSource(SourceTexture_S& source, const cv::Mat& raw, GLint internalFormat, GLenum format, GLenum type);
+    void updatePalette(DepthColormapType colormap);
+
+private:
+    bool mIsReady = false;
+    GLuint mPrograms[SHADER_COUNT] = { 0, 0, 0 };
+    SourceTexture_S mSources[SHADER_COUNT];
+    GLuint mFramebuffer = 0;
+    GLuint mVertexArray = 0;
+    GLuint mPalette = 0;                            // 1D, 256 RGB colors
+    DepthColormapType mPaletteColormap = DEPTH_COLORMAP_COUNT;
+};
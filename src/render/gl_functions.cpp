@@ -0,0 +1,115 @@
+#include "gl_functions.h"
+#include <stdio.h>
+#include <string.h>
+
+GLFunctions_S gl;
+
+template<typename T>
+static bool loadFunction(T& function, const char* name)
+{
+    function = (T)glfwGetProcAddress(name);
+    return function != NULL;
+}
+
+bool loadGLFunctions()
+{
+    memset(&gl, 0, sizeof(gl));
+
+    bool isLoaded = true;
+    isLoaded &= loadFunction(gl.genBuffers, "glGenBuffers");
+    isLoaded &= loadFunction(gl.deleteBuffers, "glDeleteBuffers");
+    isLoaded &= loadFunction(gl.bindBuffer, "glBindBuffer");
+    isLoaded &= loadFunction(gl.bufferData, "glBufferData");
+    isLoaded &= loadFunction(gl.mapBuffer, "glMapBuffer");
+    isLoaded &= loadFunction(gl.unmapBuffer, "glUnmapBuffer");
+    GLFWwindow* context = glfwGetCurrentContext();
+    int major = glfwGetWindowAttrib(context, GLFW_CONTEXT_VERSION_MAJOR);
+    int minor = glfwGetWindowAttrib(context, GLFW_CONTEXT_VERSION_MINOR);
+    bool isGL21 = major > 2 || (major == 2 && minor >= 1);
+    gl.hasPixelBuffers = isLoaded && (isGL21 || glfwExtensionSupported("GL_ARB_pixel_buffer_object"));
+    if (!gl.hasPixelBuffers) printf("[WARN] Pixel buffer objects unavailable, textures are uploaded directly\n");
+
+    bool hasShaders = major >= 3;
+    hasShaders &= loadFunction(gl.createShader, "glCreateShader");
+    hasShaders &= loadFunction(gl.shaderSource, "glShaderSource");
+    hasShaders &= loadFunction(gl.compileShader, "glCompileShader");
+    hasShaders &= loadFunction(gl.getShaderiv, "glGetShaderiv");
+    hasShaders &= loadFunction(gl.getShaderInfoLog, "glGetShaderInfoLog");
+    hasShaders &= loadFunction(gl.deleteShader, "glDeleteShader");
+    hasShaders &= loadFunction(gl.createProgram, "glCreateProgram");
+    hasShaders &= loadFunction(gl.attachShader, "glAttachShader");
+    hasShaders &= loadFunction(gl.linkProgram, "glLinkProgram");
+    hasShaders &= loadFunction(gl.getProgramiv, "glGetProgramiv");
+    hasShaders &= loadFunction(gl.getProgramInfoLog, "glGetProgramInfoLog");
+    hasShaders &= loadFunction(gl.deleteProgram, "glDeleteProgram");
+    hasShaders &= loadFunction(gl.useProgram, "glUseProgram");
+    hasShaders &= loadFunction(gl.getUniformLocation, "glGetUniformLocation");
+    hasShaders &= loadFunction(gl.uniform1i, "glUniform1i");
+    hasShaders &= loadFunction(gl.uniform1f, "glUniform1f");
+    hasShaders &= loadFunction(gl.uniform2f, "glUniform2f");
+    hasShaders &= loadFunction(gl.uniform3f, "glUniform3f");
+    hasShaders &= loadFunction(gl.activeTexture, "glActiveTexture");
+    hasShaders &= loadFunction(gl.bindAttribLocation, "glBindAttribLocation");
+    hasShaders &= loadFunction(gl.vertexAttribPointer, "glVertexAttribPointer");
+    hasShaders &= loadFunction(gl.enableVertexAttribArray, "glEnableVertexAttribArray");
+    hasShaders &= loadFunction(gl.disableVertexAttribArray, "glDisableVertexAttribArray");
+    hasShaders &= loadFunction(gl.genFramebuffers, "glGenFramebuffers");
+    hasShaders &= loadFunction(gl.deleteFramebuffers, "glDeleteFramebuffers");
+    hasShaders &= loadFunction(gl.bindFramebuffer, "glBindFramebuffer");
+    hasShaders &= loadFunction(gl.framebufferTexture2D, "glFramebufferTexture2D");
+    hasShaders &= loadFunction(gl.checkFramebufferStatus, "glCheckFramebufferStatus");
+    hasShaders &= loadFunction(gl.genVertexArrays, "glGenVertexArrays");
+    hasShaders &= loadFunction(gl.deleteVertexArrays, "glDeleteVertexArrays");
+    hasShaders &= loadFunction(gl.bindVertexArray, "glBindVertexArray");
+    hasShaders &= loadFunction(gl.mapBufferRange, "glMapBufferRange");
+    gl.hasShaders = hasShaders;
+    if (!gl.hasShaders) printf("[WARN] OpenGL 3.0 unavailable, frames are converted on the CPU and point clouds drawn point by point\n");
+
+    return isLoaded && hasShaders;
+}
+
+static GLuint compileShader(GLenum type, const char* source)
+{
+    GLuint shader = gl.createShader(type);
+    gl.shaderSource(shader, 1, &source, NULL);
+    gl.compileShader(shader);
+    GLint status = 0;
+    gl.getShaderiv(shader, GL_COMPILE_STATUS, &status);
+    if (!status) {
+        char log[1024] = { 0 };
+        gl.getShaderInfoLog(shader, sizeof(log), NULL, log);
+        printf("[ERR] Compile shader failed: %s\n", log);
+        gl.deleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+GLuint linkProgram(const char* vertexSource, const char* fragmentSource, const char* const* attributes)
+{
+    GLuint vertex = compileShader(GL_VERTEX_SHADER, vertexSource);
+    GLuint fragment = compileShader(GL_FRAGMENT_SHADER, fragmentSource);
+    GLuint program = 0;
+    if (vertex != 0 && fragment != 0) {
+        program = gl.createProgram();
+        gl.attachShader(program, vertex);
+        gl.attachShader(program, fragment);
+        for (GLuint i = 0; attributes != NULL && attributes[i] != NULL; i++) {
+            gl.bindAttribLocation(program, i, attributes[i]);
+        }
+        gl.linkProgram(program);
+        GLint status = 0;
+        gl.getProgramiv(program, GL_LINK_STATUS, &status);
+        if (!status) {
+            char log[1024] = { 0 };
+            gl.getProgramInfoLog(program, sizeof(log), NULL, log);
+            printf("[ERR] Link shader failed: %s\n", log);
+            gl.deleteProgram(program);
+            program = 0;
+        }
+    }
+    // The program keeps them alive while attached
+    if (vertex != 0) gl.deleteShader(vertex);
+    if (fragment != 0) gl.deleteShader(fragment);
+    return program;
+}
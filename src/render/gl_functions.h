@@ -0,0 +1,121 @@
+#pragma once
+#include <GLFW/glfw3.h>
+#include <stddef.h>
+
+// OpenGL entry points past 1.1. The system headers only declare 1.1 on Windows, so they are
+// looked up from the current context with glfwGetProcAddress() instead.
+#ifndef APIENTRY
+#define APIENTRY
+#endif
+
+#ifndef GL_PIXEL_UNPACK_BUFFER
+#define GL_PIXEL_UNPACK_BUFFER  0x88EC
+#endif
+#ifndef GL_STREAM_DRAW
+#define GL_STREAM_DRAW          0x88E0
+#endif
+#ifndef GL_WRITE_ONLY
+#define GL_WRITE_ONLY           0x88B9
+#endif
+#ifndef GL_CLAMP_TO_EDGE
+#define GL_CLAMP_TO_EDGE        0x812F
+#endif
+#ifndef GL_TEXTURE0
+#define GL_TEXTURE0             0x84C0
+#define GL_TEXTURE1             0x84C1
+#endif
+#ifndef GL_FRAGMENT_SHADER
+#define GL_FRAGMENT_SHADER      0x8B30
+#define GL_VERTEX_SHADER        0x8B31
+#define GL_COMPILE_STATUS       0x8B81
+#define GL_LINK_STATUS          0x8B82
+#define GL_INFO_LOG_LENGTH      0x8B84
+#endif
+#ifndef GL_FRAMEBUFFER
+#define GL_FRAMEBUFFER          0x8D40
+#define GL_COLOR_ATTACHMENT0    0x8CE0
+#define GL_FRAMEBUFFER_COMPLETE 0x8CD5
+#define GL_FRAMEBUFFER_BINDING  0x8CA6
+#endif
+#ifndef GL_RG
+#define GL_RG                   0x8227
+#define GL_R8                   0x8229
+#define GL_R16                  0x822A
+#define GL_RG8                  0x822B
+#endif
+#ifndef GL_CURRENT_PROGRAM
+#define GL_CURRENT_PROGRAM      0x8B8D
+#endif
+#ifndef GL_VERTEX_ARRAY_BINDING
+#define GL_VERTEX_ARRAY_BINDING 0x85B5
+#endif
+#ifndef GL_ACTIVE_TEXTURE
+#define GL_ACTIVE_TEXTURE       0x84E0
+#endif
+#ifndef GL_ARRAY_BUFFER
+#define GL_ARRAY_BUFFER         0x8892
+#define GL_ARRAY_BUFFER_BINDING 0x8894
+#endif
+#ifndef GL_MAP_WRITE_BIT
+#define GL_MAP_WRITE_BIT                0x0002
+#define GL_MAP_INVALIDATE_BUFFER_BIT    0x0008
+#define GL_MAP_UNSYNCHRONIZED_BIT       0x0020
+#endif
+
+typedef struct GLFunctions_S {
+    // Buffer objects, GL 1.5; pixel buffer objects, GL 2.1
+    void (APIENTRY* genBuffers)(GLsizei n, GLuint* buffers);
+    void (APIENTRY* deleteBuffers)(GLsizei n, const GLuint* buffers);
+    void (APIENTRY* bindBuffer)(GLenum target, GLuint buffer);
+    void (APIENTRY* bufferData)(GLenum target, ptrdiff_t size, const void* data, GLenum usage);
+    void* (APIENTRY* mapBuffer)(GLenum target, GLenum access);
+    GLboolean (APIENTRY* unmapBuffer)(GLenum target);
+
+    // Shaders, GL 2.0
+    GLuint (APIENTRY* createShader)(GLenum type);
+    void (APIENTRY* shaderSource)(GLuint shader, GLsizei count, const char* const* source, const GLint* length);
+    void (APIENTRY* compileShader)(GLuint shader);
+    void (APIENTRY* getShaderiv)(GLuint shader, GLenum name, GLint* value);
+    void (APIENTRY* getShaderInfoLog)(GLuint shader, GLsizei size, GLsizei* length, char* log);
+    void (APIENTRY* deleteShader)(GLuint shader);
+    GLuint (APIENTRY* createProgram)();
+    void (APIENTRY* attachShader)(GLuint program, GLuint shader);
+    void (APIENTRY* linkProgram)(GLuint program);
+    void (APIENTRY* getProgramiv)(GLuint program, GLenum name, GLint* value);
+    void (APIENTRY* getProgramInfoLog)(GLuint program, GLsizei size, GLsizei* length, char* log);
+    void (APIENTRY* deleteProgram)(GLuint program);
+    void (APIENTRY* useProgram)(GLuint program);
+    GLint (APIENTRY* getUniformLocation)(GLuint program, const char* name);
+    void (APIENTRY* uniform1i)(GLint location, GLint value);
+    void (APIENTRY* uniform1f)(GLint location, GLfloat value);
+    void (APIENTRY* uniform2f)(GLint location, GLfloat x, GLfloat y);
+    void (APIENTRY* uniform3f)(GLint location, GLfloat x, GLfloat y, GLfloat z);
+    void (APIENTRY* activeTexture)(GLenum texture);
+    void (APIENTRY* bindAttribLocation)(GLuint program, GLuint index, const char* name);
+    void (APIENTRY* vertexAttribPointer)(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* pointer);
+    void (APIENTRY* enableVertexAttribArray)(GLuint index);
+    void (APIENTRY* disableVertexAttribArray)(GLuint index);
+
+    // Framebuffer and vertex array objects, mapped buffer ranges, GL 3.0
+    void (APIENTRY* genFramebuffers)(GLsizei n, GLuint* framebuffers);
+    void (APIENTRY* deleteFramebuffers)(GLsizei n, const GLuint* framebuffers);
+    void (APIENTRY* bindFramebuffer)(GLenum target, GLuint framebuffer);
+    void (APIENTRY* framebufferTexture2D)(GLenum target, GLenum attachment, GLenum textureTarget, GLuint texture, GLint level);
+    GLenum (APIENTRY* checkFramebufferStatus)(GLenum target);
+    void (APIENTRY* genVertexArrays)(GLsizei n, GLuint* arrays);
+    void (APIENTRY* deleteVertexArrays)(GLsizei n, const GLuint* arrays);
+    void (APIENTRY* bindVertexArray)(GLuint array);
+    void* (APIENTRY* mapBufferRange)(GLenum target, ptrdiff_t offset, ptrdiff_t length, GLbitfield access);
+
+    bool hasPixelBuffers;
+    bool hasShaders;            // GL 3.0 with GLSL 1.30, see FrameShader and PointCloudRenderer
+} GLFunctions_S;
+
+extern GLFunctions_S gl;
+
+// Call with the context current; returns false when a feature is unavailable, which its users check
+bool loadGLFunctions();
+
+// Needs hasShaders. Vertex attributes in the NULL terminated list are bound to their index.
+// Returns 0 on failure, with the log printed
+GLuint linkProgram(const char* vertexSource, const char* fragmentSource, const char* const* attributes = NULL);
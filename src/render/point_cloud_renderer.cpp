@@ -0,0 +1,108 @@
+#include "point_cloud_renderer.h"
+#include "trace.h"
+#include <string.h>
+
+// Points are in millimeters with Y pointing down, the view has meters with Y up
+static const char* s_vertexShader =
+    "#version 130\n"
+    "in vec3 position;\n"
+    "in vec3 color;\n"
+    "out vec3 pointColor;\n"
+    "void main() {\n"
+    "    gl_Position = gl_ModelViewProjectionMatrix * vec4(position * vec3(0.001, -0.001, 0.001), 1.0);\n"
+    "    pointColor = color / 255.0;\n"
+    "}\n";
+
+static const char* s_fragmentShader =
+    "#version 130\n"
+    "in vec3 pointColor;\n"
+    "out vec4 color;\n"
+    "void main() {\n"
+    "    color = vec4(pointColor, 1.0);\n"
+    "}\n";
+
+// Attribute indices follow this order
+static const char* s_attributes[] = { "position", "color", NULL };
+
+bool PointCloudRenderer::init()
+{
+    if (mIsReady) return true;
+    if (!gl.hasShaders) return false;
+
+    mProgram = linkProgram(s_vertexShader, s_fragmentShader, s_attributes);
+    if (mProgram == 0) return false;
+
+    GLint lastArrayBuffer, lastVertexArray;
+    glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &lastArrayBuffer);
+    glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &lastVertexArray);
+    gl.genBuffers(1, &mVertexBuffer);
+    gl.genVertexArrays(1, &mVertexArray);
+    gl.bindVertexArray(mVertexArray);
+    gl.bindBuffer(GL_ARRAY_BUFFER, mVertexBuffer);
+    gl.vertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(OBColorPoint), (const void*)offsetof(OBColorPoint, x));
+    gl.vertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(OBColorPoint), (const void*)offsetof(OBColorPoint, r));
+    gl.enableVertexAttribArray(0);
+    gl.enableVertexAttribArray(1);
+    gl.bindVertexArray(lastVertexArray);
+    gl.bindBuffer(GL_ARRAY_BUFFER, lastArrayBuffer);
+    mIsReady = true;
+    return true;
+}
+
+void PointCloudRenderer::release()
+{
+    if (!gl.hasShaders) return;
+    if (mProgram != 0) gl.deleteProgram(mProgram);
+    if (mVertexBuffer != 0) gl.deleteBuffers(1, &mVertexBuffer);
+    if (mVertexArray != 0) gl.deleteVertexArrays(1, &mVertexArray);
+    mProgram = mVertexBuffer = mVertexArray = 0;
+    mCapacity = mPointCount = 0;
+    mIsReady = false;
+}
+
+void PointCloudRenderer::update(const OBColorPoint* points, size_t count)
+{
+    OB_TRACE_SCOPE("PointCloudRenderer::update");
+    mPointCount = 0;
+    if (!mIsReady || points == NULL || count == 0) return;
+
+    size_t size = count * sizeof(OBColorPoint);
+    GLint lastArrayBuffer;
+    glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &lastArrayBuffer);
+    gl.bindBuffer(GL_ARRAY_BUFFER, mVertexBuffer);
+    if (size > mCapacity) {
+        gl.bufferData(GL_ARRAY_BUFFER, size, points, GL_STREAM_DRAW);
+        mCapacity = size;
+    }
+    else {
+        // Invalidating the whole buffer hands the driver fresh storage while the last draw
+        // still reads the old one, so the mapping does not need to be synchronized
+        void* mapped = gl.mapBufferRange(GL_ARRAY_BUFFER, 0, size,
+            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+        if (mapped != NULL) {
+            memcpy(mapped, points, size);
+            gl.unmapBuffer(GL_ARRAY_BUFFER);
+        }
+        else {
+            gl.bufferData(GL_ARRAY_BUFFER, size, points, GL_STREAM_DRAW);
+            mCapacity = size;
+        }
+    }
+    gl.bindBuffer(GL_ARRAY_BUFFER, lastArrayBuffer);
+    mPointCount = count;
+}
+
+void PointCloudRenderer::draw()
+{
+    OB_TRACE_SCOPE("PointCloudRenderer::draw");
+    if (!mIsReady || mPointCount == 0) return;
+
+    GLint lastProgram, lastVertexArray;
+    glGetIntegerv(GL_CURRENT_PROGRAM, &lastProgram);
+    glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &lastVertexArray);
+    gl.useProgram(mProgram);
+    gl.bindVertexArray(mVertexArray);
+    glDrawArrays(GL_POINTS, 0, (GLsizei)mPointCount);
+    gl.bindVertexArray(lastVertexArray);
+    gl.useProgram(lastProgram);
+}
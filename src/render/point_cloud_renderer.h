@@ -0,0 +1,28 @@
+#pragma once
+#include "gl_functions.h"
+#include "libobsensor/ObSensor.hpp"
+
+// Draws a point cloud with one glDrawArrays call. OBColorPoint data is copied as it is into a
+// vertex buffer, position and color interleaved, and the vertex shader converts millimeters to
+// meters and flips Y. The buffer is orphaned on every update so the copy never waits for the
+// draw of the previous cloud. Uses the fixed-function matrices, set them up before draw().
+class PointCloudRenderer
+{
+public:
+    // Call with the context current; false leaves it unusable and clouds are drawn point by point
+    bool init();
+    void release();
+    inline bool isReady() const { return mIsReady; }
+
+    void update(const OBColorPoint* points, size_t count);
+    void draw();
+    inline size_t size() const { return mPointCount; }
+
+private:
+    bool mIsReady = false;
+    GLuint mProgram = 0;
+    GLuint mVertexBuffer = 0;
+    GLuint mVertexArray = 0;
+    size_t mCapacity = 0;           // Bytes allocated for mVertexBuffer
+    size_t mPointCount = 0;
+};
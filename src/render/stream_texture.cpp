@@ -0,0 +1,75 @@
+#include "stream_texture.h"
+#include "frame_convert.h"
+#include "trace.h"
+#include <string.h>
+
+void StreamTexture::update(const cv::Mat& image)
+{
+    OB_TRACE_SCOPE("StreamTexture::update");
+    if (image.empty()) return;
+
+    cv::Mat rgb;
+    convertTextureImage(image, rgb);
+    if (rgb.empty()) return;
+    int w = rgb.cols;
+    int h = rgb.rows;
+    size_t rowSize = (size_t)w * 3;
+    size_t size = rowSize * h;
+
+    allocate(w, h);
+    glBindTexture(GL_TEXTURE_2D, mTexture);
+    // Rows of 3 byte pixels are not 4 byte aligned for every width
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    if (gl.hasPixelBuffers) {
+        if (mPixelBuffers[0] == 0) gl.genBuffers(2, mPixelBuffers);
+        mPixelBufferIndex = 1 - mPixelBufferIndex;
+        gl.bindBuffer(GL_PIXEL_UNPACK_BUFFER, mPixelBuffers[mPixelBufferIndex]);
+        // Orphaning hands the driver a fresh store, the one still being copied from is not waited for
+        gl.bufferData(GL_PIXEL_UNPACK_BUFFER, (ptrdiff_t)size, NULL, GL_STREAM_DRAW);
+        uint8_t* mapped = (uint8_t*)gl.mapBuffer(GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY);
+        if (mapped != NULL) {
+            if (rgb.isContinuous()) {
+                memcpy(mapped, rgb.data, size);
+            }
+            else {
+                for (int y = 0; y < h; y++) memcpy(mapped + rowSize * y, rgb.ptr(y), rowSize);
+            }
+            gl.unmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            // Offset 0 into the bound buffer, returns once the copy is queued
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, w, h, GL_RGB, GL_UNSIGNED_BYTE, NULL);
+        }
+        gl.bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+    else {
+        if (!rgb.isContinuous()) rgb = rgb.clone();
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, w, h, GL_RGB, GL_UNSIGNED_BYTE, rgb.data);
+    }
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void StreamTexture::allocate(int width, int height)
+{
+    if (mTexture != 0 && width == mWidth && height == mHeight) return;
+    if (mTexture == 0) glGenTextures(1, &mTexture);
+    glBindTexture(GL_TEXTURE_2D, mTexture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    mWidth = width;
+    mHeight = height;
+}
+
+void StreamTexture::release()
+{
+    if (mTexture != 0) glDeleteTextures(1, &mTexture);
+    if (mPixelBuffers[0] != 0) gl.deleteBuffers(2, mPixelBuffers);
+    mTexture = 0;
+    mPixelBuffers[0] = mPixelBuffers[1] = 0;
+    mWidth = mHeight = 0;
+}
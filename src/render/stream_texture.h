@@ -0,0 +1,28 @@
+#pragma once
+#include "gl_functions.h"
+#include <opencv2/opencv.hpp>
+
+// Texture of one stream kept across frames, reallocated only when the image size changes.
+// Frames go through two pixel buffer objects in turn: the driver copies one into the texture
+// while the next frame is written into the other, so uploads do not block the UI thread.
+// Holds GL objects but does not own them past release(), call it while the context is current.
+class StreamTexture
+{
+public:
+    // 8 bit gray or RGB image
+    void update(const cv::Mat& image);
+    // RGB storage of the given size for rendering into, see FrameShader; keeps the contents when the size is unchanged
+    void allocate(int width, int height);
+    void release();
+    inline GLuint id() const { return mTexture; }
+    inline bool empty() const { return mTexture == 0; }
+    inline int width() const { return mWidth; }
+    inline int height() const { return mHeight; }
+
+private:
+    GLuint mTexture = 0;
+    GLuint mPixelBuffers[2] = { 0, 0 };
+    int mPixelBufferIndex = 0;
+    int mWidth = 0;
+    int mHeight = 0;
+};
@@ -1,20 +1,40 @@
 #include "service.h"
+#include <fstream>
 
-Service::Service(int& state, int deviceIndex) :
-	mSensors(new Sensors)
+Service::Service(int& state, int deviceIndex, std::shared_ptr<DeviceEnumerator> enumerator) :
+	mSensors(new Sensors(enumerator))
 {
+	for (int i = 0; i < STREAM_COUNT; i++) mConvertedFrames[i] = 0;
+	mSensors->setFrameArrivedCallback([this](StreamIndex stream) { onFrameArrived(stream); });
+	startConvertWorkers();
 	state = initCamera(deviceIndex);
 	if (!state) return;
 }
 
-Service::~Service() { delete mSensors; }
+Service::Service(std::shared_ptr<FrameSource> source) :
+	mSensors(new Sensors(nullptr))
+{
+	for (int i = 0; i < STREAM_COUNT; i++) mConvertedFrames[i] = 0;
+	mSensors->setFrameArrivedCallback([this](StreamIndex stream) { onFrameArrived(stream); });
+	startConvertWorkers();
+	mRecentDevice = -1;
+	mSensorName = source->getName();
+	mSerialNum = "SYNTHETIC";
+	mSensors->initFrameSource(source);
+}
+
+Service::~Service()
+{
+	stopConvertWorkers();
+	delete mSensors;
+}
 
 int Service::initCamera(int deviceIndex)
 {
 	int ret;
 	mRecentDevice = -1;
 	mSensorList = mSensors->getSensorList();
-	int devCount = mSensorList->deviceCount();
+	int devCount = mSensorList != nullptr ? mSensorList->deviceCount() : 0;
 
 	if (devCount == 0) { return INIT_RESULT_NO_DEVICE; }
 	if (devCount <= deviceIndex || deviceIndex < 0) { return INIT_RESULT_DEVICE_SELECT_ERROR; }
@@ -26,7 +46,6 @@ int Service::initCamera(int deviceIndex)
 	SensorInfo_S sInfo;
 	mSensors->getCurSensorInfo(sInfo);
 
-	mSensorListStr = *mSensors->getSensorStrList();
 	mDepthModeStrList = *mSensors->getCurDepthWorkModeStrList();
 	mDepthMode = mSensors->getCurDepthWorkMode();
 
@@ -34,8 +53,6 @@ int Service::initCamera(int deviceIndex)
 	mSerialNum = sInfo.serialNum;
 	mSensorPID = sInfo.pid;
 
-	mDepthValueScale = OBDepthPrecisionLevelToFloat((OBDepthPrecisionLevel)mSensors->getDepthPrecisionLevel());
-
 	mColorMirror = mSensors->getColorMirror();
 	mDepthMirror = mSensors->getDepthMirror();
 	mIRMirror = mSensors->getIRMirror();
@@ -57,7 +74,7 @@ int Service::resetCamera()
 
 std::vector<std::string>* Service::getSensorStrList()
 {
-	return &mSensorListStr;
+	return mSensors->getSensorStrList();
 }
 
 std::vector<std::string>* Service::getSensorInfo(OBSensorType sensorType)
@@ -202,7 +219,8 @@ void Service::toggleD2CAlignment(int type)
 }
 bool Service::toggleLaserEnable(bool state)
 {
-	mLaserEnable = mSensors->setLaserEnable(state);
+	mLaserEnable = state;
+	mSensors->setLaserEnable(state);
 	return mLaserEnable;
 }
 
@@ -337,22 +355,99 @@ void Service::setColorGainValue(int value)
 // Depth
 void Service::getDepthDispRange(int* range)
 {
-	memcpy(range, mDepthDispRange, sizeof(mDepthDispRange));
+	std::lock_guard<std::mutex> lock(mMutex);
+	memcpy(range, mDepthColorParam.dispRange, sizeof(mDepthColorParam.dispRange));
 }
 void Service::setDepthDispRange(int* range)
 {
-	memcpy(mDepthDispRange, range, sizeof(mDepthDispRange));
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		if (memcmp(mDepthColorParam.dispRange, range, sizeof(mDepthColorParam.dispRange)) == 0) return;
+		memcpy(mDepthColorParam.dispRange, range, sizeof(mDepthColorParam.dispRange));
+		mConvertParamVersion++;
+	}
+	invalidateConversion(STREAM_DEPTH);
+}
+DepthColormapType Service::getDepthColormap()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mDepthColorParam.colormap;
+}
+void Service::setDepthColormap(DepthColormapType colormap)
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		if (mDepthColorParam.colormap == colormap) return;
+		mDepthColorParam.colormap = colormap;
+		mConvertParamVersion++;
+	}
+	invalidateConversion(STREAM_DEPTH);
+}
+cv::Vec3b Service::getDepthInvalidColor()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mDepthColorParam.invalidColor;
+}
+void Service::setDepthInvalidColor(const cv::Vec3b& color)
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		if (mDepthColorParam.invalidColor == color) return;
+		mDepthColorParam.invalidColor = color;
+		mConvertParamVersion++;
+	}
+	invalidateConversion(STREAM_DEPTH);
+}
+
+void Service::setDepthFilter(DepthFilterType filter, int filterSize)
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		if (mDepthFilter == filter && mDepthFilterSize == filterSize) return;
+		mDepthFilter = filter;
+		mDepthFilterSize = filterSize;
+		mConvertParamVersion++;
+	}
+	invalidateConversion(STREAM_DEPTH);
+}
+
+DepthColorParam_S Service::getDepthColorParam()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mDepthColorParam;
+}
+
+void Service::setRawPreview(bool state)
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		if (mIsRawPreview == state) return;
+		mIsRawPreview = state;
+		mConvertParamVersion++;
+	}
+	for (int i = 0; i < STREAM_COUNT; i++) invalidateConversion((StreamIndex)i);
+}
+
+bool Service::isRawPreview()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mIsRawPreview;
+}
+
+void Service::setColorDisplaySize(int width, int height)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	mColorDisplaySize[0] = width;
+	mColorDisplaySize[1] = height;
 }
 
 int Service::getDepthPrecisionLevel()
 {
 	return mSensors->getDepthPrecisionLevel();
 }
-bool Service::setDepthPrecisionLevel(int level)
+void Service::setDepthPrecisionLevel(int level)
 {
-	bool ret = mSensors->setDepthPrecisionLevel(level);
-	if (ret) mDepthValueScale = OBDepthPrecisionLevelToFloat((OBDepthPrecisionLevel)level);
-	return ret;
+	mSensors->setDepthPrecisionLevel(level);
 }
 
 void Service::toggleDepthAutoExposure(bool state)
@@ -435,13 +530,18 @@ bool Service::getMDCAStatus()
 }
 
 void Service::startFrameCapturing(bool* is_checked, int frame_num)
-{ 
-	std::copy(is_checked, is_checked + 3, mIsCapturing); 
-	mTotalFrame = frame_num; 
+{
+	{
+		// The convert workers read it to convert at full resolution on the CPU
+		std::lock_guard<std::mutex> lock(mMutex);
+		std::copy(is_checked, is_checked + 3, mIsCapturing);
+	}
+	mTotalFrame = frame_num;
 }
 
 void Service::captureFrames()
 {
+	OB_TRACE_SCOPE("captureFrames");
 	std::string output_folder = "CapturedFrames";
 	createSubDirectory(output_folder);
 	string curDateTime = getCurrentDateTime(true);
@@ -451,35 +551,42 @@ void Service::captureFrames()
 	char IRFileName[255];
 
 	if (mIsCapturing[0]) {
+		const ImageSlot_S& colorSlot = mImageBuffers[STREAM_COLOR].front();
 		if (mFrameCount[0] > mTotalFrame) {
+			std::lock_guard<std::mutex> lock(mMutex);
 			mIsCapturing[0] = false;
 			mFrameCount[0] = 0;
 		}
-		else {
+		// Skips the preview sized images converted before capturing started
+		else if (!colorSlot.image.empty() && colorSlot.image.cols == colorSlot.frame.width) {
 			sprintf(colorFileName, "%s/Color_%s_%lld.png", output_folder.c_str(), curDateTime.c_str(), mFrameCount[0]);
-			cv::imwrite(colorFileName, mColorBGRMat);
+			cv::Mat colorBGRMat;
+			cv::cvtColor(colorSlot.image, colorBGRMat, cv::COLOR_RGB2BGR);
+			cv::imwrite(colorFileName, colorBGRMat);
 			printf("File saved: %s\n", colorFileName);
 		}
 	}
 	if (mIsCapturing[1]) {
 		if (mFrameCount[1] > mTotalFrame) {
+			std::lock_guard<std::mutex> lock(mMutex);
 			mIsCapturing[1] = false;
 			mFrameCount[1] = 0;
 		}
 		else {
 			sprintf(depthFileName, "%s/Depth_%s_%lld.png", output_folder.c_str(), curDateTime.c_str(), mFrameCount[1]);
-			cv::imwrite(depthFileName, mDepthRawMat);
+			cv::imwrite(depthFileName, mImageBuffers[STREAM_DEPTH].front().raw);
 			printf("File saved: %s\n", depthFileName);
 		}
 	}
 	if (mIsCapturing[2]) {
 		if (mFrameCount[2] > mTotalFrame) {
+			std::lock_guard<std::mutex> lock(mMutex);
 			mIsCapturing[2] = false;
 			mFrameCount[2] = 0;
 		}
-		else {
+		else if (!mImageBuffers[STREAM_IR].front().image.empty()) {
 			sprintf(IRFileName, "%s/IR_%s_%lld.png", output_folder.c_str(), curDateTime.c_str(), mFrameCount[2]);
-			cv::imwrite(IRFileName, mIRMat);
+			cv::imwrite(IRFileName, mImageBuffers[STREAM_IR].front().image);
 			printf("File saved: %s\n", IRFileName);
 		}
 	}
@@ -488,125 +595,214 @@ void Service::captureFrames()
 	if (!capturing_check) mTotalFrame = 0;
 }
 
-void Service::getPointCloudPoints(vector<OBColorPoint>& points, bool is_color) {
-	mSensors->generatePointCloudPoints(points, is_color); 
+const PointCloudSlot_S* Service::getPointCloud(bool is_color, bool* isUpdated)
+{
+	mSensors->setPointCloudColor(is_color);
+	bool updated = mSensors->updatePointCloud();
+	if (isUpdated != NULL) *isUpdated = updated;
+
+	const PointCloudSlot_S& slot = mSensors->getPointCloud();
+	return slot.count > 0 ? &slot : NULL;
 }
 
 void Service::readFrame()
 {
-	mSensors->readFrame();
 	if (mTotalFrame) {
 		captureFrames();
 	}
 }
 
-cv::Mat* Service::getColorMat()
+void Service::startConvertWorkers()
 {
-	auto frame = mSensors->getCurColorFrame();
-	if (frame == nullptr || frame->dataSize() < 1024) {
-		return NULL;
+	mIsConverting = true;
+	for (int i = 0; i < STREAM_COUNT; i++) {
+		mConvertThreads[i] = std::thread(&Service::convertLoop, this, (StreamIndex)i);
 	}
-	
-	auto videoFrame = frame->as<ob::VideoFrame>();
+}
 
-	if (videoFrame->type() == OB_FRAME_COLOR && videoFrame->format() == OB_FORMAT_MJPG) {
-		cv::Mat rawMat(1, videoFrame->dataSize(), CV_8UC1, videoFrame->data());
-		mColorBGRMat = cv::imdecode(rawMat, 1);
-		cv::cvtColor(mColorBGRMat, mColorRGBMat, cv::COLOR_RGB2BGR);
-	}
-	else if (videoFrame->type() == OB_FRAME_COLOR && videoFrame->format() == OB_FORMAT_NV21) {
-		cv::Mat rawMat(videoFrame->height() * 3 / 2, videoFrame->width(), CV_8UC1, videoFrame->data());
-		cv::cvtColor(rawMat, mColorRGBMat, cv::COLOR_YUV2BGR_NV21);
-	}
-	else if (videoFrame->type() == OB_FRAME_COLOR && (videoFrame->format() == OB_FORMAT_YUYV || videoFrame->format() == OB_FORMAT_YUY2)) {
-		cv::Mat rawMat(videoFrame->height(), videoFrame->width(), CV_8UC2, videoFrame->data());
-		cv::cvtColor(rawMat, mColorBGRMat, cv::COLOR_YUV2BGR_YUY2);
-		cv::cvtColor(mColorBGRMat, mColorRGBMat, cv::COLOR_RGB2BGR);
+void Service::stopConvertWorkers()
+{
+	{
+		std::lock_guard<std::mutex> lock(mConvertMutex);
+		mIsConverting = false;
 	}
-	else if (videoFrame->type() == OB_FRAME_COLOR && videoFrame->format() == OB_FORMAT_RGB888) {
-		cv::Mat rawMat(videoFrame->height(), videoFrame->width(), CV_8UC3, videoFrame->data());
-		cv::cvtColor(rawMat, mColorBGRMat, cv::COLOR_RGB2BGR);
-		cv::cvtColor(mColorBGRMat, mColorRGBMat, cv::COLOR_RGB2BGR);
-	}
-
-	if (mIsCapturing[0]) {
-		if (mPreviousFrameIdx[0] != frame->index()) {
-			mFrameCount[0]++;
-			mPreviousFrameIdx[0] = frame->index();
-		}
+	mConvertCond.notify_all();
+	for (int i = 0; i < STREAM_COUNT; i++) {
+		if (mConvertThreads[i].joinable()) mConvertThreads[i].join();
 	}
+}
 
-	return &mColorRGBMat;
+// Wake the worker so the current frame is converted again with the new parameters
+void Service::invalidateConversion(StreamIndex stream)
+{
+	onFrameArrived(stream);
 }
 
-cv::Mat* Service::getDepthMat()
+void Service::onFrameArrived(StreamIndex stream)
 {
-	auto frame = mSensors->getCurDepthFrame();
-	if (frame == nullptr || frame->dataSize() < 1024) {
-		return NULL;
+	{
+		std::lock_guard<std::mutex> lock(mConvertMutex);
+		mIsFramePending[stream] = true;
 	}
+	mConvertCond.notify_all();
+}
 
-	auto videoFrame = frame->as<ob::VideoFrame>();
+// Worker: convert each newly published frame of one stream and hand the result to the UI
+void Service::convertLoop(StreamIndex stream)
+{
+	OB_TRACE_THREAD(stream == STREAM_COLOR ? "convert color" : stream == STREAM_DEPTH ? "convert depth" : "convert ir");
+	TripleBuffer<ImageSlot_S>& buffer = mImageBuffers[stream];
+	// Memoization key of the last published conversion
+	uint64_t lastIndex = 0;
+	uint32_t lastVersion = 0;
+	bool isConverted = false;
 
-	if (videoFrame->format() == OB_FORMAT_Y16) {
-		cv::Mat cvtMat, cvTmpMat;
-		mDepthRawMat = cv::Mat(videoFrame->height(), videoFrame->width(), CV_16UC1, videoFrame->data());
-		// depth frame pixel value multiply scale to get distance in millimeter
-		float scale = videoFrame->as<ob::DepthFrame>()->getValueScale();
+	while (mIsConverting) {
+		{
+			std::unique_lock<std::mutex> lock(mConvertMutex);
+			mConvertCond.wait(lock, [this, stream] { return !mIsConverting || mIsFramePending[stream]; });
+			mIsFramePending[stream] = false;
+		}
+		if (!mIsConverting) break;
+
+		mSensors->updateFrame(stream);
+		const FrameSlot_S& frame = mSensors->getFrame(stream);
+
+		DepthColorParam_S colorParam;
+		DepthFilterType filter;
+		int filterSize;
+		int displaySize[2];
+		bool isCapturing;
+		bool isRawPreview;
+		uint32_t version;
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			colorParam = mDepthColorParam;
+			filter = mDepthFilter;
+			filterSize = mDepthFilterSize;
+			memcpy(displaySize, mColorDisplaySize, sizeof(displaySize));
+			isCapturing = mIsCapturing[stream];
+			isRawPreview = mIsRawPreview;
+			version = mConvertParamVersion;
+		}
 
-		cv::inRange(mDepthRawMat, cv::Scalar(mDepthDispRange[0]), cv::Scalar(mDepthDispRange[1]), cvTmpMat);
-		mDepthRawMat.copyTo(cvtMat, cvTmpMat);
+		// Same frame and same parameters, the published image is still valid
+		bool hasData = frame.data != NULL && frame.dataSize >= 1024;
+		if (isConverted && hasData && frame.index == lastIndex && version == lastVersion) continue;
+
+		ImageSlot_S& slot = buffer.back();
+		slot.frame = frame;
+		slot.raw.release();
+		bool isRaw = hasData && isRawPreview && !isCapturing && (stream != STREAM_DEPTH || filter == DEPTH_FILTER_NONE) && wrapRawFrame(slot);
+		if (hasData && !isRaw) {
+			if (stream == STREAM_COLOR) {
+				OB_TRACE_SCOPE("convertColorFrame");
+				int reduction = isCapturing ? 1 : selectJpegReduction(frame.width, frame.height, displaySize[0], displaySize[1]);
+				convertColorFrame(slot, reduction);
+			}
+			else if (stream == STREAM_DEPTH) {
+				OB_TRACE_SCOPE("convertDepthFrame");
+				convertDepthFrame(slot, colorParam);
+				applyDepthFilter(slot.image, filter, filterSize);
+			}
+			else {
+				OB_TRACE_SCOPE("convertIRFrame");
+				convertIRFrame(slot);
+			}
+		}
+		uint64_t publishTimeUs = frame.publishTimeUs;
+		buffer.publish();
+		if (hasData && frame.index != lastIndex) {
+			mConvertedFrames[stream]++;
+			mSensors->getStreamStats(stream).onFrameConverted(publishTimeUs, StreamStats::nowUs());
+		}
 
-		// threshold to 5.12m
-		//cv::threshold(cvTmpMat, cvtMat, 5120.0f / scale, 0, cv::THRESH_TRUNC);
-		cvtMat.convertTo(cvtMat, CV_8UC1, scale * 0.05);
-		cv::applyColorMap(cvtMat, mDepthBGRMat, cv::COLORMAP_JET);
-		cvtColor(mDepthBGRMat, mDepthMat, CV_RGB2BGR);
+		isConverted = hasData;
+		lastIndex = frame.index;
+		lastVersion = version;
 	}
+}
 
-	if (mIsCapturing[1]) {
-		if (mPreviousFrameIdx[1] != frame->index()) {
-			mFrameCount[1]++;
-			mPreviousFrameIdx[1] = frame->index();
-		}
-	}
+StreamCounters_S Service::getStreamCounters(StreamIndex stream)
+{
+	StreamCounters_S counters = mSensors->getStreamCounters(stream);
+	counters.converted = mConvertedFrames[stream];
+	return counters;
+}
 
-	return &mDepthMat;
+StreamStats_S Service::getStreamStats(StreamIndex stream)
+{
+	StreamStats_S stats;
+	StreamCounters_S counters = getStreamCounters(stream);
+	stats.received = counters.received;
+	stats.deviceDropped = counters.deviceDropped;
+	stats.hostDropped = counters.received > counters.converted ? counters.received - counters.converted : 0;
+	FrameRingStats_S ringStats = mSensors->getFrameRingStats();
+	stats.ringDropped = ringStats.overflowDropped + ringStats.skipped;
+	// getCurFrameInfo() orders depth before color
+	stats.nominalFps = mSensors->getCurFrameInfo(stream == STREAM_COLOR ? 1 : stream == STREAM_DEPTH ? 0 : 2).fps;
+	mSensors->getStreamStats(stream).getTiming(stats);
+	return stats;
 }
 
-cv::Mat* Service::getIRMat()
+// One JSON object with the stats of every stream, for monitoring scripts
+bool Service::dumpStreamStats(const std::string& fileName)
 {
-	auto frame = mSensors->getCurIRFrame();
-	if (frame == nullptr || frame->dataSize() < 1024) {
-		return NULL;
+	static const char* streamNames[STREAM_COUNT] = { "color", "depth", "ir" };
+	std::ofstream file(fileName, std::ios::trunc);
+	if (!file.is_open()) {
+		printf("[ERR] Write stream stats failed: %s\n", fileName.c_str());
+		return false;
 	}
-
-	auto videoFrame = frame->as<ob::VideoFrame>();
-	if (videoFrame->format() == OB_FORMAT_Y16 || videoFrame->format() == OB_FORMAT_YUYV || videoFrame->format() == OB_FORMAT_YUY2) {
-		cv::Mat cvtMat;
-		mIRRawMat = cv::Mat(videoFrame->height(), videoFrame->width(), CV_16UC1, videoFrame->data());
-		float scale = 1.0f / (float)pow(2, videoFrame->pixelAvailableBitSize() - 8);
-		cv::convertScaleAbs(mIRRawMat, cvtMat, scale);
-		cv::cvtColor(cvtMat, mIRMat, cv::COLOR_GRAY2RGB);
+	file << "{ \"serialNumber\": \"" << mSerialNum << "\", \"time\": \"" << getCurrentDateTime(true) << "\",\n";
+	for (int i = 0; i < STREAM_COUNT; i++) {
+		file << "  ";
+		writeStreamStatsJson(file, streamNames[i], getStreamStats((StreamIndex)i));
+		file << (i + 1 < STREAM_COUNT ? ",\n" : "\n");
 	}
+	file << "}\n";
+	return true;
+}
 
-	if (is_ir_frame(videoFrame->type()) && videoFrame->format() == OB_FORMAT_Y8) {
-		mIRRawMat = cv::Mat(videoFrame->height(), videoFrame->width(), CV_8UC1, videoFrame->data());
+// Return the newest converted image of a stream
+const ImageSlot_S* Service::getImageSlot(StreamIndex stream, bool* isUpdated)
+{
+	TripleBuffer<ImageSlot_S>& buffer = mImageBuffers[stream];
+	bool updated = buffer.update();
+	if (isUpdated != NULL) *isUpdated = updated;
 
-		cv::cvtColor(mIRRawMat, mIRMat, cv::COLOR_GRAY2RGB);
-	}
-	else if (is_ir_frame(videoFrame->type()) && videoFrame->format() == OB_FORMAT_MJPG) {
-		cv::Mat rawMat(1, videoFrame->dataSize(), CV_8UC1, videoFrame->data());
-		mIRMat = cv::imdecode(rawMat, 1);
+	ImageSlot_S& slot = buffer.front();
+	if (slot.frame.data == NULL || slot.frame.dataSize < 1024 || slot.raw.empty()) {
+		return NULL;
 	}
 
-	if (mIsCapturing[2]) {
-		if (mPreviousFrameIdx[2] != frame->index()) {
-			mFrameCount[2]++;
-			mPreviousFrameIdx[2] = frame->index();
+	if (mIsCapturing[stream]) {
+		if (mPreviousFrameIdx[stream] != slot.frame.index) {
+			mFrameCount[stream]++;
+			mPreviousFrameIdx[stream] = slot.frame.index;
 		}
 	}
 
-	return &mIRMat;
+	return &slot;
 }
 
+cv::Mat* Service::getImage(StreamIndex stream, bool* isUpdated)
+{
+	const ImageSlot_S* slot = getImageSlot(stream, isUpdated);
+	return slot != NULL ? &mImageBuffers[stream].front().image : NULL;
+}
+
+cv::Mat* Service::getColorMat(bool* isUpdated)
+{
+	return getImage(STREAM_COLOR, isUpdated);
+}
+
+cv::Mat* Service::getDepthMat(bool* isUpdated)
+{
+	return getImage(STREAM_DEPTH, isUpdated);
+}
+
+cv::Mat* Service::getIRMat(bool* isUpdated)
+{
+	return getImage(STREAM_IR, isUpdated);
+}
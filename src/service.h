@@ -2,14 +2,19 @@
 #include <opencv2/opencv.hpp>
 #include "opencv2/imgproc/types_c.h"
 #include "orbbec_sensors.h"
+#include "frame_convert.h"
 #include <numeric>
+#include <condition_variable>
 
 extern bool g_isStereoCamera;
 
 class Service
 {
 public:
-	Service(int& state, int deviceIndex = 0);
+	// Services of several devices opened at once share one enumerator, see getDeviceEnumerator()
+	Service(int& state, int deviceIndex = 0, std::shared_ptr<DeviceEnumerator> enumerator = nullptr);
+	// Runs on frames of a source instead of a device, e.g. SyntheticFrameSource; device controls are unavailable
+	explicit Service(std::shared_ptr<FrameSource> source);
 	~Service();
 	int initCamera(int deviceIndex);
 	int resetCamera();
@@ -23,6 +28,8 @@ public:
 	inline int getRecentDevice() { return mRecentDevice; }
 	inline std::string getSerialNum() { return mSerialNum; }
 	inline std::string getSensorName() { return mSensorName; }
+	inline std::shared_ptr<DeviceEnumerator> getDeviceEnumerator() { return mSensors->getDeviceEnumerator(); }
+	inline bool isDeviceLost() { return mSensors->isDeviceLost(); }
 
 	inline std::vector<std::string>* getCurDepthWorkModeStrList() { return &mDepthModeStrList; }
 	inline int getCurDepthWorkMode() { return mDepthMode; }
@@ -42,11 +49,27 @@ public:
 
 	int getVideoMode(const std::shared_ptr<ob::VideoStreamProfile>& videoMode, std::vector<std::string>& modeList);
 
+	// Group stream/profile/alignment changes so the pipeline restarts once at the commit
+	inline void beginReconfiguration() { mSensors->beginReconfiguration(); }
+	inline bool commitReconfiguration() { return mSensors->commitReconfiguration(); }
+	inline double getLastRestartMs() { return mSensors->getLastRestartMs(); }
+	inline uint32_t getRestartCount() { return mSensors->getRestartCount(); }
+	inline double getLastInitMs() { return mSensors->getLastInitMs(); }
+
+	// Drive streams per sensor so toggling one does not interrupt the others (not with frame sync, D2C or the point cloud)
+	inline void setSensorStreaming(bool state) { mSensors->setSensorStreaming(state); }
+	inline bool isSensorDriven() { return mSensors->isSensorDriven(); }
+
 	void switchDepthStream(bool state);
 	void switchColorStream(bool state);
 	void switchIRStream(bool state);
 
 	// Device Control
+	// Property writes are queued on a control thread and coalesced, see DeviceControlQueue
+	inline ControlStatus getControlStatus(OBPropertyID id) { return mSensors->getControlStatus(id); }
+	// Property reads are served from a snapshot taken on the control thread after the device was opened, see DevicePropertyCache
+	inline uint64_t getPropertyCacheHits() { return mSensors->getPropertyCacheHits(); }
+	inline uint64_t getPropertyCacheMisses() { return mSensors->getPropertyCacheMisses(); }
 	bool toggleFrameSync();
 	void toggleD2CAlignment(int type);
 	bool toggleLaserEnable(bool state);
@@ -69,8 +92,14 @@ public:
 	// Depth
 	void getDepthDispRange(int* range);
 	void setDepthDispRange(int* range);
+	DepthColormapType getDepthColormap();
+	void setDepthColormap(DepthColormapType colormap);
+	cv::Vec3b getDepthInvalidColor();
+	void setDepthInvalidColor(const cv::Vec3b& color);
 	int getDepthPrecisionLevel();
-	bool setDepthPrecisionLevel(int level);
+	// Queued, the depth value scale follows once the device took the level
+	void setDepthPrecisionLevel(int level);
+	inline float getDepthValueScale() { return mSensors->getDepthValueScale(); }
 	void toggleDepthAutoExposure(bool state);
 	int getDepthExposureValue();
 	void setDepthExposureValue(int value);
@@ -93,19 +122,37 @@ public:
 	void startFrameCapturing(bool* is_checked, int frame_num);
 	bool isFrameCapturing() { return mTotalFrame; }
 	void readFrame();
-
-	cv::Mat* getColorMat();
-	cv::Mat* getDepthMat();
-	cv::Mat* getIRMat();
+	inline void setAcquisitionMode(AcquisitionMode mode, int ringDepth, FrameRingPolicy policy) { mSensors->setAcquisitionMode(mode, ringDepth, policy); }
+	inline AcquisitionMode getAcquisitionMode() { return mSensors->getAcquisitionMode(); }
+	inline FrameRingStats_S getFrameRingStats() { return mSensors->getFrameRingStats(); }
+	StreamCounters_S getStreamCounters(StreamIndex stream);
+	// Counters plus measured fps and latency percentiles
+	StreamStats_S getStreamStats(StreamIndex stream);
+	bool dumpStreamStats(const std::string& fileName);
+
+	// isUpdated is set when the returned image differs from the one returned by the previous call
+	cv::Mat* getColorMat(bool* isUpdated = NULL);
+	cv::Mat* getDepthMat(bool* isUpdated = NULL);
+	cv::Mat* getIRMat(bool* isUpdated = NULL);
+	void setDepthFilter(DepthFilterType filter, int filterSize);
+	DepthColorParam_S getDepthColorParam();
+	// Leave depth, IR and packed YUV color frames unconverted for the display shaders; frames being
+	// captured or depth with a filter are still converted
+	void setRawPreview(bool state);
+	bool isRawPreview();
+	// Newest converted slot; its image is empty when the frame was left raw, see setRawPreview()
+	const ImageSlot_S* getImageSlot(StreamIndex stream, bool* isUpdated = NULL);
+	// Size the color image is shown at; MJPG is decoded at a reduced scale that still covers it, except while capturing
+	void setColorDisplaySize(int width, int height);
 
 	void togglePointCloud() { mSensors->togglePointCloud(); };
-	void getPointCloudPoints(vector<OBColorPoint>& points, bool is_color);
+	// Newest point cloud, NULL until one was produced; isUpdated as for the images above
+	const PointCloudSlot_S* getPointCloud(bool is_color, bool* isUpdated = NULL);
 
 private:
-	std::mutex  mMutex;
+	std::mutex  mMutex;		// guards conversion parameters shared with the convert workers
 	Sensors* mSensors;
 	std::shared_ptr<ob::DeviceList> mSensorList;
-	std::vector<std::string> mSensorListStr;
 
 	std::vector<std::string> mDepthModeStrList;
 	int mDepthMode;
@@ -114,21 +161,28 @@ private:
 	std::vector<std::string> mColorSupportedModeList;
 	std::vector<std::string> mIRSupportedModeList;
 
-	cv::Mat mColorBGRMat;
-	cv::Mat mColorRGBMat;
-	cv::Mat mDepthMat;
-	cv::Mat mDepthBGRMat;
-	cv::Mat mDepthRawMat;
-	cv::Mat mIRMat;
-	cv::Mat mIRRawMat;
+	// Converted images per stream, indexed by StreamIndex; written by the convert workers, read by the UI
+	TripleBuffer<ImageSlot_S> mImageBuffers[STREAM_COUNT];
+
+	// One conversion worker per stream, woken when Sensors publishes a frame of that stream
+	std::thread mConvertThreads[STREAM_COUNT];
+	std::atomic<bool> mIsConverting{ false };
+	std::mutex mConvertMutex;
+	std::condition_variable mConvertCond;
+	bool mIsFramePending[STREAM_COUNT] = { false, false, false };
+	std::atomic<uint64_t> mConvertedFrames[STREAM_COUNT];
 
 	std::string mSerialNum;
 	std::string mSensorName;
 	int mSensorPID = -1;
 	int mRecentDevice;
 	int mCurDepthMode = -1;
-	float mDepthValueScale = 1.0f;
-	int mDepthDispRange[2] = { 0, 5000 };
+	DepthColorParam_S mDepthColorParam;
+	DepthFilterType mDepthFilter = DEPTH_FILTER_NONE;
+	int mColorDisplaySize[2] = { 0, 0 };	// 0: full resolution
+	bool mIsRawPreview = false;
+	int mDepthFilterSize = 5;
+	uint32_t mConvertParamVersion = 0;	// Bumped whenever a conversion parameter changes
 	bool mLaserEnable = false;
 	bool mIRFlood = true;
 	int mExposureValue = 0;
@@ -144,5 +198,11 @@ private:
 	int mTotalFrame = 0;
 
 	void captureFrames();
+	void startConvertWorkers();
+	void stopConvertWorkers();
+	void onFrameArrived(StreamIndex stream);
+	void convertLoop(StreamIndex stream);
+	void invalidateConversion(StreamIndex stream);
+	cv::Mat* getImage(StreamIndex stream, bool* isUpdated);
 };
 
@@ -0,0 +1,107 @@
+#include "stream_stats.h"
+#include <chrono>
+#include <string.h>
+
+void LatencyHistogram::clear()
+{
+    memset(m_buckets, 0, sizeof(m_buckets));
+    m_count = 0;
+    m_max = 0.0;
+}
+
+void LatencyHistogram::add(double ms)
+{
+    if (ms < 0.0) ms = 0.0;
+    int bucket = (int)(ms * 2.0);
+    if (bucket >= BUCKET_COUNT) bucket = BUCKET_COUNT - 1;
+    m_buckets[bucket]++;
+    m_count++;
+    if (ms > m_max) m_max = ms;
+}
+
+double LatencyHistogram::percentile(double p) const
+{
+    if (m_count == 0) return 0.0;
+    uint64_t target = (uint64_t)(p * (m_count - 1)) + 1;
+    uint64_t sum = 0;
+    for (int i = 0; i < BUCKET_COUNT - 1; i++) {
+        sum += m_buckets[i];
+        if (sum >= target) return (i + 1) * 0.5;
+    }
+    return m_max;
+}
+
+void StreamStats::reset()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_timeCount = 0;
+    m_timeNext = 0;
+    m_minOffsetUs = 0;
+    m_bIsOffsetValid = false;
+    m_delivery.clear();
+    m_host.clear();
+}
+
+void StreamStats::onFrameReceived(uint64_t deviceTimeStampUs, uint64_t systemTimeStampUs, uint64_t publishTimeUs)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_systemTimes[m_timeNext] = systemTimeStampUs;
+    m_deviceTimes[m_timeNext] = deviceTimeStampUs;
+    m_timeNext = (m_timeNext + 1) % FPS_WINDOW;
+    if (m_timeCount < FPS_WINDOW) m_timeCount++;
+
+    int64_t offset = (int64_t)publishTimeUs - (int64_t)deviceTimeStampUs;
+    if (!m_bIsOffsetValid || offset < m_minOffsetUs) {
+        m_minOffsetUs = offset;
+        m_bIsOffsetValid = true;
+    }
+    m_delivery.add((offset - m_minOffsetUs) / 1000.0);
+}
+
+void StreamStats::onFrameConverted(uint64_t publishTimeUs, uint64_t convertedTimeUs)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_host.add(((int64_t)convertedTimeUs - (int64_t)publishTimeUs) / 1000.0);
+}
+
+void StreamStats::getTiming(StreamStats_S& stats)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    stats.fps = stats.deviceFps = 0.0;
+    if (m_timeCount > 1) {
+        int first = (m_timeNext - m_timeCount + FPS_WINDOW) % FPS_WINDOW;
+        int last = (m_timeNext - 1 + FPS_WINDOW) % FPS_WINDOW;
+        double systemSpan = (double)m_systemTimes[last] - (double)m_systemTimes[first];
+        double deviceSpan = (double)m_deviceTimes[last] - (double)m_deviceTimes[first];
+        if (systemSpan > 0) stats.fps = (m_timeCount - 1) * 1000000.0 / systemSpan;
+        if (deviceSpan > 0) stats.deviceFps = (m_timeCount - 1) * 1000000.0 / deviceSpan;
+    }
+
+    stats.deliveryP50 = m_delivery.percentile(0.50);
+    stats.deliveryP90 = m_delivery.percentile(0.90);
+    stats.deliveryP99 = m_delivery.percentile(0.99);
+    stats.deliveryMax = m_delivery.max();
+    stats.hostP50 = m_host.percentile(0.50);
+    stats.hostP90 = m_host.percentile(0.90);
+    stats.hostP99 = m_host.percentile(0.99);
+    stats.hostMax = m_host.max();
+}
+
+uint64_t StreamStats::nowUs()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void writeStreamStatsJson(std::ostream& out, const char* streamName, const StreamStats_S& stats)
+{
+    out << "\"" << streamName << "\": { "
+        << "\"nominalFps\": " << stats.nominalFps << ", "
+        << "\"fps\": " << stats.fps << ", "
+        << "\"deviceFps\": " << stats.deviceFps << ", "
+        << "\"received\": " << stats.received << ", "
+        << "\"deviceDropped\": " << stats.deviceDropped << ", "
+        << "\"hostDropped\": " << stats.hostDropped << ", "
+        << "\"ringDropped\": " << stats.ringDropped << ", "
+        << "\"deliveryMs\": { \"p50\": " << stats.deliveryP50 << ", \"p90\": " << stats.deliveryP90 << ", \"p99\": " << stats.deliveryP99 << ", \"max\": " << stats.deliveryMax << " }, "
+        << "\"hostMs\": { \"p50\": " << stats.hostP50 << ", \"p90\": " << stats.hostP90 << ", \"p99\": " << stats.hostP99 << ", \"max\": " << stats.hostMax << " } }";
+}
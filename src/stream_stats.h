@@ -0,0 +1,69 @@
+#pragma once
+#include <mutex>
+#include <ostream>
+#include <stdint.h>
+
+// Frame timing of one stream together with its counters, as shown in the UI and written by the stats dump
+typedef struct StreamStats_S {
+    double nominalFps = 0.0;            // fps of the selected profile
+    double fps = 0.0;                   // measured from the host arrival times of the last frames
+    double deviceFps = 0.0;             // measured from the device timestamps of the same frames
+    uint64_t received = 0;
+    uint64_t deviceDropped = 0;         // gaps in the frame index, framesets the ring dropped show up here too
+    uint64_t hostDropped = 0;           // received but superseded before conversion
+    uint64_t ringDropped = 0;           // framesets the acquisition ring overflowed or skipped, shared by all streams
+    double deliveryP50 = 0.0, deliveryP90 = 0.0, deliveryP99 = 0.0, deliveryMax = 0.0;     // ms, device to publish
+    double hostP50 = 0.0, hostP90 = 0.0, hostP99 = 0.0, hostMax = 0.0;                     // ms, publish to converted
+} StreamStats_S;
+
+void writeStreamStatsJson(std::ostream& out, const char* streamName, const StreamStats_S& stats);
+
+// Latency distribution in 0.5 ms buckets; the last bucket collects everything slower
+class LatencyHistogram
+{
+public:
+    static const int BUCKET_COUNT = 512;
+
+    LatencyHistogram() { clear(); }
+    void clear();
+    void add(double ms);
+    // p in 0..1, reports the upper edge of the bucket the percentile falls into
+    double percentile(double p) const;
+    inline double max() const { return m_max; }
+
+private:
+    uint64_t m_buckets[BUCKET_COUNT];
+    uint64_t m_count;
+    double m_max;
+};
+
+// Timing of the frames of one stream. The device clock is not synchronized with the host, so delivery
+// latency is the device-to-host clock offset of a frame minus the smallest offset seen since the last reset;
+// it shows how much later than the fastest frame a frame arrived, which is what grows when USB bandwidth collapses.
+class StreamStats
+{
+public:
+    StreamStats() { reset(); }
+    void reset();
+
+    // Host times are steady clock microseconds, see nowUs()
+    void onFrameReceived(uint64_t deviceTimeStampUs, uint64_t systemTimeStampUs, uint64_t publishTimeUs);
+    void onFrameConverted(uint64_t publishTimeUs, uint64_t convertedTimeUs);
+    // Fills the timing fields of stats, the counters are left to the caller
+    void getTiming(StreamStats_S& stats);
+
+    static uint64_t nowUs();
+
+private:
+    static const int FPS_WINDOW = 30;
+
+    std::mutex m_mutex;
+    uint64_t m_systemTimes[FPS_WINDOW];
+    uint64_t m_deviceTimes[FPS_WINDOW];
+    int m_timeCount;
+    int m_timeNext;
+    int64_t m_minOffsetUs;
+    bool m_bIsOffsetValid;
+    LatencyHistogram m_delivery;
+    LatencyHistogram m_host;
+};
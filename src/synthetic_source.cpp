@@ -0,0 +1,231 @@
+#include "synthetic_source.h"
+#include "stream_stats.h"
+#include <opencv2/opencv.hpp>
+#include <random>
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+SyntheticFrameSource::SyntheticFrameSource(uint32_t seed) :
+    m_seed(seed)
+{
+    m_streams[STREAM_COLOR].config.format = OB_FORMAT_RGB888;
+    m_streams[STREAM_DEPTH].config.format = OB_FORMAT_Y16;
+    m_streams[STREAM_IR].config.format = OB_FORMAT_Y16;
+}
+
+SyntheticFrameSource::~SyntheticFrameSource()
+{
+    for (int i = 0; i < STREAM_COUNT; i++) {
+        setStreamEnabled((StreamIndex)i, false);
+    }
+}
+
+void SyntheticFrameSource::setStreamConfig(StreamIndex stream, const SyntheticStreamConfig_S& config)
+{
+    static const OBFormat defaultFormats[STREAM_COUNT] = { OB_FORMAT_RGB888, OB_FORMAT_Y16, OB_FORMAT_Y16 };
+    SyntheticStreamConfig_S checked = config;
+    OBFormat format = config.format;
+    bool isSupported = format == OB_FORMAT_UNKNOWN
+        || (stream == STREAM_COLOR && (format == OB_FORMAT_MJPG || format == OB_FORMAT_YUYV || format == OB_FORMAT_UYVY || format == OB_FORMAT_NV21
+            || format == OB_FORMAT_NV12 || format == OB_FORMAT_I420 || format == OB_FORMAT_RGB888))
+        || (stream == STREAM_DEPTH && format == OB_FORMAT_Y16)
+        || (stream == STREAM_IR && (format == OB_FORMAT_Y16 || format == OB_FORMAT_Y8 || format == OB_FORMAT_MJPG));
+    if (!isSupported) {
+        printf("[ERR] Synthetic stream %d does not support %s, using %s.\n", stream, OBFormatToString(format).c_str(), OBFormatToString(defaultFormats[stream]).c_str());
+    }
+    if (!isSupported || format == OB_FORMAT_UNKNOWN) checked.format = defaultFormats[stream];
+    // YUV 4:2:x needs even sizes
+    checked.width = std::max(2, config.width & ~1);
+    checked.height = std::max(2, config.height & ~1);
+    if (checked.fps <= 0) checked.fps = 30.0;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_streams[stream].config = checked;
+}
+
+void SyntheticFrameSource::setStreamEnabled(StreamIndex stream, bool state)
+{
+    StreamState_S& s = m_streams[stream];
+    if (state) {
+        if (s.thread.joinable()) return;
+        buildPool(stream, s);
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            s.isRunning = true;
+        }
+        s.thread = std::thread(&SyntheticFrameSource::streamLoop, this, stream);
+    }
+    else {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            s.isRunning = false;
+        }
+        m_cond.notify_all();
+        if (s.thread.joinable()) s.thread.join();
+    }
+}
+
+FrameInfo_S SyntheticFrameSource::getFrameInfo(StreamIndex stream)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    FrameInfo_S info;
+    info.w = (short)m_streams[stream].config.width;
+    info.h = (short)m_streams[stream].config.height;
+    info.fps = m_streams[stream].config.fps;
+    return info;
+}
+
+void SyntheticFrameSource::buildPool(StreamIndex stream, StreamState_S& state)
+{
+    SyntheticStreamConfig_S config;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        config = state.config;
+    }
+    state.pool.clear();
+    for (int k = 0; k < POOL_SIZE; k++) {
+        state.pool.push_back(buildFrame(stream, config, (float)k / POOL_SIZE, m_seed * 31 + stream * POOL_SIZE + k));
+    }
+}
+
+// Gradient with a bar at barPosition (0 to 1 across the width), plus noise
+std::shared_ptr<std::vector<uint8_t>> SyntheticFrameSource::buildFrame(StreamIndex stream, const SyntheticStreamConfig_S& config, float barPosition, uint32_t seed)
+{
+    int w = config.width, h = config.height;
+    int barBegin = (int)(w * barPosition);
+    int barEnd = barBegin + w / 16;
+    cv::RNG rng(seed);
+    std::shared_ptr<std::vector<uint8_t>> buffer = std::make_shared<std::vector<uint8_t>>();
+
+    if (stream == STREAM_DEPTH || (stream == STREAM_IR && config.format == OB_FORMAT_Y16)) {
+        // Depth in millimeter from 0.5 m to 4.5 m; IR in 10 bit
+        cv::Mat image(h, w, CV_16UC1);
+        for (int y = 0; y < h; y++) {
+            uint16_t* row = image.ptr<uint16_t>(y);
+            for (int x = 0; x < w; x++) {
+                int value = stream == STREAM_DEPTH ? 500 + 4000 * x / w : 1023 * (x + y) / (w + h);
+                if (x >= barBegin && x < barEnd) value = stream == STREAM_DEPTH ? 800 : 1023;
+                if (config.noise > 0) value += rng.uniform(-config.noise, config.noise + 1);
+                row[x] = (uint16_t)std::min(std::max(value, 0), 65535);
+            }
+        }
+        buffer->assign(image.data, image.data + image.total() * image.elemSize());
+        return buffer;
+    }
+
+    cv::Mat rgb(h, w, CV_8UC3);
+    for (int y = 0; y < h; y++) {
+        cv::Vec3b* row = rgb.ptr<cv::Vec3b>(y);
+        for (int x = 0; x < w; x++) {
+            bool isBar = x >= barBegin && x < barEnd;
+            row[x] = isBar ? cv::Vec3b(255, 255, 255) : cv::Vec3b((uint8_t)(255 * x / w), (uint8_t)(255 * y / h), 128);
+        }
+    }
+    if (config.noise > 0) {
+        cv::Mat noise(h, w, CV_8UC3);
+        rng.fill(noise, cv::RNG::UNIFORM, 0, config.noise + 1);
+        rgb += noise;
+    }
+
+    if (config.format == OB_FORMAT_RGB888) {
+        buffer->assign(rgb.data, rgb.data + rgb.total() * rgb.elemSize());
+    }
+    else if (config.format == OB_FORMAT_Y8) {
+        cv::Mat gray;
+        cv::cvtColor(rgb, gray, cv::COLOR_RGB2GRAY);
+        buffer->assign(gray.data, gray.data + gray.total());
+    }
+    else if (config.format == OB_FORMAT_MJPG) {
+        cv::Mat bgr;
+        cv::cvtColor(rgb, bgr, cv::COLOR_RGB2BGR);
+        cv::imencode(".jpg", bgr, *buffer);
+    }
+    else if (config.format == OB_FORMAT_YUYV || config.format == OB_FORMAT_UYVY) {
+        // Y0 U Y1 V or U Y0 V Y1, chroma of the left pixel of each pair
+        bool isUYVY = config.format == OB_FORMAT_UYVY;
+        cv::Mat yuv;
+        cv::cvtColor(rgb, yuv, cv::COLOR_RGB2YUV);
+        buffer->resize(w * h * 2);
+        uint8_t* out = buffer->data();
+        for (int y = 0; y < h; y++) {
+            const cv::Vec3b* row = yuv.ptr<cv::Vec3b>(y);
+            for (int x = 0; x < w; x += 2) {
+                out[isUYVY ? 1 : 0] = row[x][0];
+                out[isUYVY ? 0 : 1] = row[x][1];
+                out[isUYVY ? 3 : 2] = row[x + 1][0];
+                out[isUYVY ? 2 : 3] = row[x][2];
+                out += 4;
+            }
+        }
+    }
+    else if (config.format == OB_FORMAT_NV21 || config.format == OB_FORMAT_NV12 || config.format == OB_FORMAT_I420) {
+        // Y plane followed by the chroma at quarter resolution: planar U, V (I420) or interleaved V U (NV21) / U V (NV12)
+        cv::Mat i420;
+        cv::cvtColor(rgb, i420, cv::COLOR_RGB2YUV_I420);
+        if (config.format == OB_FORMAT_I420) {
+            buffer->assign(i420.data, i420.data + w * h * 3 / 2);
+            return buffer;
+        }
+        const uint8_t* planeY = i420.data;
+        const uint8_t* planeU = planeY + w * h;
+        const uint8_t* planeV = planeU + w * h / 4;
+        const uint8_t* first = config.format == OB_FORMAT_NV21 ? planeV : planeU;
+        const uint8_t* second = config.format == OB_FORMAT_NV21 ? planeU : planeV;
+        buffer->resize(w * h * 3 / 2);
+        uint8_t* out = buffer->data();
+        memcpy(out, planeY, w * h);
+        out += w * h;
+        for (int i = 0; i < w * h / 4; i++) {
+            *out++ = first[i];
+            *out++ = second[i];
+        }
+    }
+    return buffer;
+}
+
+void SyntheticFrameSource::streamLoop(StreamIndex stream)
+{
+    static const OBFrameType frameTypes[STREAM_COUNT] = { OB_FRAME_COLOR, OB_FRAME_DEPTH, OB_FRAME_IR };
+    StreamState_S& state = m_streams[stream];
+    SyntheticStreamConfig_S config;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        config = state.config;
+    }
+
+    std::mt19937 rng(m_seed * 131 + stream);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    uint64_t periodUs = (uint64_t)(1000000.0 / config.fps);
+
+    for (uint64_t index = 1; ; index++) {
+        // Capture time on the device clock; delivery may lag it by the jitter
+        uint64_t captureUs = periodUs * index;
+        uint64_t deliveryUs = captureUs + (uint64_t)(uniform(rng) * config.jitterMs * 1000.0);
+        bool isDropped = uniform(rng) < config.dropRate;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cond.wait_until(lock, begin + std::chrono::microseconds(deliveryUs), [&state] { return !state.isRunning; });
+            if (!state.isRunning) break;
+        }
+        if (isDropped) continue;
+
+        const std::shared_ptr<std::vector<uint8_t>>& buffer = state.pool[index % state.pool.size()];
+        FrameSlot_S slot;
+        slot.holder = buffer;
+        slot.data = buffer->data();
+        slot.dataSize = (uint32_t)buffer->size();
+        slot.width = config.width;
+        slot.height = config.height;
+        slot.type = frameTypes[stream];
+        slot.format = config.format;
+        slot.pixelBitSize = config.format == OB_FORMAT_Y16 ? (stream == STREAM_DEPTH ? 16 : 10) : 8;
+        slot.valueScale = 1.0f;
+        slot.index = index;
+        slot.timeStampUs = captureUs;
+        slot.systemTimeStampUs = StreamStats::nowUs();
+        if (m_frameHandler) m_frameHandler(stream, slot);
+    }
+}
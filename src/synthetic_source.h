@@ -0,0 +1,59 @@
+#pragma once
+#include "frame_source.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <vector>
+
+typedef struct SyntheticStreamConfig_S {
+    int width = 640;
+    int height = 480;
+    OBFormat format = OB_FORMAT_UNKNOWN;    // UNKNOWN picks the stream default: RGB888 color, Y16 depth and IR
+    double fps = 30.0;
+    int noise = 0;                          // amplitude of the uniform per-pixel noise, in pixel value units
+    double dropRate = 0.0;                  // probability of a frame being dropped; its index is used up, like a device drop
+    double jitterMs = 0.0;                  // each frame is delivered up to this much after its capture time
+} SyntheticStreamConfig_S;
+
+// Generates test patterns for reproducible load without hardware.
+// Color: MJPG, YUYV, UYVY, NV21, NV12, I420, RGB888. Depth: Y16. IR: Y16, Y8, MJPG.
+// Every stream cycles through a small pool of frames built when it is enabled, so delivering a
+// frame costs no generation or encoding time; the noise, drops and jitter follow a seeded generator.
+class SyntheticFrameSource : public FrameSource
+{
+public:
+    explicit SyntheticFrameSource(uint32_t seed = 1);
+    ~SyntheticFrameSource();
+
+    // Takes effect the next time the stream is enabled
+    void setStreamConfig(StreamIndex stream, const SyntheticStreamConfig_S& config);
+
+    std::string getName() override { return "Synthetic"; }
+    void setFrameHandler(FrameHandler handler) override { m_frameHandler = handler; }
+    void setStreamEnabled(StreamIndex stream, bool state) override;
+    FrameInfo_S getFrameInfo(StreamIndex stream) override;
+
+    // One pattern frame in the stream's wire format, as delivered; config must be valid for the stream
+    static std::shared_ptr<std::vector<uint8_t>> buildFrame(StreamIndex stream, const SyntheticStreamConfig_S& config, float barPosition, uint32_t seed);
+
+private:
+    static const int POOL_SIZE = 8;
+
+    typedef struct StreamState_S {
+        SyntheticStreamConfig_S config;
+        std::vector<std::shared_ptr<std::vector<uint8_t>>> pool;
+        std::thread thread;
+        bool isRunning = false;         // guarded by m_mutex
+    } StreamState_S;
+
+    void buildPool(StreamIndex stream, StreamState_S& state);
+    void streamLoop(StreamIndex stream);
+
+private:
+    uint32_t m_seed;
+    FrameHandler m_frameHandler;
+    std::mutex m_mutex;
+    std::condition_variable m_cond;     // wakes a stream thread early when it is stopped
+    StreamState_S m_streams[STREAM_COUNT];
+};
@@ -0,0 +1,161 @@
+#include "trace.h"
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <algorithm>
+#include <memory>
+#include <chrono>
+#include <fstream>
+#include <stdio.h>
+
+typedef struct TraceEvent_S {
+    const char* name;
+    uint64_t beginUs;
+    uint64_t durationUs;
+} TraceEvent_S;
+
+// Written by its thread only; the mutex is uncontended except while a dump copies it
+typedef struct TraceRing_S {
+    std::mutex mutex;
+    std::vector<TraceEvent_S> events;
+    size_t next = 0;
+    bool isWrapped = false;
+    bool isExited = false;          // the thread is gone, the ring is dropped once dumped
+    uint32_t threadId = 0;
+    std::string threadName;
+} TraceRing_S;
+
+// Per thread state; the ring is allocated by the first event, threads that never record while
+// recording is on cost no ring
+typedef struct ThreadTrace_S {
+    std::string threadName;
+    std::shared_ptr<TraceRing_S> ring;
+
+    ~ThreadTrace_S()
+    {
+        if (ring == nullptr) return;
+        std::lock_guard<std::mutex> lock(ring->mutex);
+        ring->isExited = true;
+    }
+} ThreadTrace_S;
+
+static std::atomic<bool> s_isRecording{ false };
+static std::mutex s_ringsMutex;
+static std::vector<std::shared_ptr<TraceRing_S>> s_rings;      // rings outlive their threads until the next dump
+static uint32_t s_nextThreadId = 1;                             // guarded by s_ringsMutex
+
+static thread_local ThreadTrace_S t_threadTrace;
+
+static TraceRing_S& threadRing()
+{
+    std::shared_ptr<TraceRing_S>& ring = t_threadTrace.ring;
+    if (ring == nullptr) {
+        ring = std::make_shared<TraceRing_S>();
+        ring->events.resize(TraceRecorder::TRACE_RING_SIZE);
+        ring->threadName = t_threadTrace.threadName;
+        std::lock_guard<std::mutex> lock(s_ringsMutex);
+        ring->threadId = s_nextThreadId++;
+        s_rings.push_back(ring);
+    }
+    return *ring;
+}
+
+void TraceRecorder::setRecording(bool state)
+{
+    s_isRecording = state;
+}
+
+bool TraceRecorder::isRecording()
+{
+    return s_isRecording.load(std::memory_order_relaxed);
+}
+
+void TraceRecorder::setThreadName(const char* name)
+{
+    t_threadTrace.threadName = name;
+    if (t_threadTrace.ring == nullptr) return;
+    std::lock_guard<std::mutex> lock(t_threadTrace.ring->mutex);
+    t_threadTrace.ring->threadName = name;
+}
+
+void TraceRecorder::record(const char* name, uint64_t beginUs, uint64_t endUs)
+{
+    TraceRing_S& ring = threadRing();
+    std::lock_guard<std::mutex> lock(ring.mutex);
+    TraceEvent_S& event = ring.events[ring.next];
+    event.name = name;
+    event.beginUs = beginUs;
+    event.durationUs = endUs - beginUs;
+    if (++ring.next == ring.events.size()) {
+        ring.next = 0;
+        ring.isWrapped = true;
+    }
+}
+
+uint64_t TraceRecorder::nowUs()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool TraceRecorder::dump(const std::string& fileName)
+{
+    std::ofstream file(fileName, std::ios::trunc);
+    if (!file.is_open()) {
+        printf("[ERR] Write trace failed: %s\n", fileName.c_str());
+        return false;
+    }
+
+    std::vector<std::shared_ptr<TraceRing_S>> rings;
+    {
+        std::lock_guard<std::mutex> lock(s_ringsMutex);
+        rings = s_rings;
+    }
+
+    size_t eventCount = 0;
+    file << "{ \"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+    bool isFirst = true;
+    for (size_t r = 0; r < rings.size(); r++) {
+        // Copy under the lock and write afterwards, the owning thread keeps recording meanwhile
+        std::vector<TraceEvent_S> events;
+        std::string threadName;
+        uint32_t threadId;
+        {
+            TraceRing_S& ring = *rings[r];
+            std::lock_guard<std::mutex> lock(ring.mutex);
+            if (ring.isWrapped) events.assign(ring.events.begin() + ring.next, ring.events.end());
+            events.insert(events.end(), ring.events.begin(), ring.events.begin() + ring.next);
+            threadName = ring.threadName;
+            threadId = ring.threadId;
+        }
+
+        if (!threadName.empty()) {
+            file << (isFirst ? "" : ",\n") << "{ \"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << threadId
+                << ", \"args\": { \"name\": \"" << threadName << "\" } }";
+            isFirst = false;
+        }
+        for (size_t i = 0; i < events.size(); i++) {
+            file << (isFirst ? "" : ",\n") << "{ \"name\": \"" << events[i].name << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << threadId
+                << ", \"ts\": " << events[i].beginUs << ", \"dur\": " << events[i].durationUs << " }";
+            isFirst = false;
+        }
+        eventCount += events.size();
+    }
+    file << "\n] }\n";
+
+    // Rings of exited threads were written above and get no more events
+    {
+        std::lock_guard<std::mutex> lock(s_ringsMutex);
+        for (size_t r = 0; r < s_rings.size();) {
+            bool isExited;
+            {
+                std::lock_guard<std::mutex> ringLock(s_rings[r]->mutex);
+                isExited = s_rings[r]->isExited;
+            }
+            if (isExited && std::find(rings.begin(), rings.end(), s_rings[r]) != rings.end()) s_rings.erase(s_rings.begin() + r);
+            else r++;
+        }
+    }
+
+    printf("Trace saved: %s (%zu events)\n", fileName.c_str(), eventCount);
+    return true;
+}
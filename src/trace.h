@@ -0,0 +1,47 @@
+#pragma once
+#include <string>
+#include <stdint.h>
+
+// Scoped trace markers for the hot paths, dumped as Chrome trace-event JSON (chrome://tracing, ui.perfetto.dev).
+// Every thread records into its own ring of the last TRACE_RING_SIZE events, so the dump shows the
+// most recent seconds of each thread. A ring is allocated by the first event of its thread and
+// freed by the first dump after the thread exited. Markers cost a flag check while recording is off,
+// naming a thread stores the name only; both compile to nothing unless OB_TRACE_ENABLED is defined
+// (ENABLE_TRACE in CMake).
+class TraceRecorder
+{
+public:
+    static const int TRACE_RING_SIZE = 16384;
+
+    static void setRecording(bool state);
+    static bool isRecording();
+    // Label of the calling thread in the trace viewer
+    static void setThreadName(const char* name);
+    // name must be a string literal or otherwise outlive the dump
+    static void record(const char* name, uint64_t beginUs, uint64_t endUs);
+    static bool dump(const std::string& fileName);
+
+    static uint64_t nowUs();
+};
+
+class TraceScope
+{
+public:
+    explicit TraceScope(const char* name) :
+        m_name(name), m_beginUs(TraceRecorder::isRecording() ? TraceRecorder::nowUs() : 0) {}
+    ~TraceScope() { if (m_beginUs != 0) TraceRecorder::record(m_name, m_beginUs, TraceRecorder::nowUs()); }
+
+private:
+    const char* m_name;
+    uint64_t m_beginUs;
+};
+
+#ifdef OB_TRACE_ENABLED
+#define OB_TRACE_CONCAT_INNER(a, b) a##b
+#define OB_TRACE_CONCAT(a, b) OB_TRACE_CONCAT_INNER(a, b)
+#define OB_TRACE_SCOPE(name) TraceScope OB_TRACE_CONCAT(obTraceScope, __LINE__)(name)
+#define OB_TRACE_THREAD(name) TraceRecorder::setThreadName(name)
+#else
+#define OB_TRACE_SCOPE(name)
+#define OB_TRACE_THREAD(name)
+#endif
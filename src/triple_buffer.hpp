@@ -0,0 +1,43 @@
+#pragma once
+#include <atomic>
+
+// Wait-free latest-value exchange between exactly one writer thread and one reader thread.
+// The writer fills back() and publish()es it; the reader calls update() and then reads front().
+// Neither side ever blocks, and the reader always sees a slot that was completely written.
+template <typename T>
+class TripleBuffer
+{
+public:
+    TripleBuffer() {}
+
+    // Writer side
+    inline T& back() { return m_slots[m_back]; }
+    void publish()
+    {
+        unsigned prev = m_middle.exchange(m_back | FRESH_BIT, std::memory_order_acq_rel);
+        m_back = prev & INDEX_MASK;
+    }
+
+    // Reader side, returns true when a newer slot became the front one
+    bool update()
+    {
+        if ((m_middle.load(std::memory_order_relaxed) & FRESH_BIT) == 0) return false;
+        unsigned prev = m_middle.exchange(m_front, std::memory_order_acq_rel);
+        m_front = prev & INDEX_MASK;
+        return true;
+    }
+    inline T& front() { return m_slots[m_front]; }
+    inline const T& front() const { return m_slots[m_front]; }
+
+private:
+    TripleBuffer(const TripleBuffer&);
+    TripleBuffer& operator=(const TripleBuffer&);
+
+    static const unsigned INDEX_MASK = 0x3;
+    static const unsigned FRESH_BIT = 0x4;
+
+    T m_slots[3];
+    unsigned m_back = 0;                    // Owned by the writer
+    std::atomic<unsigned> m_middle{ 1 };    // Shared, slot index plus FRESH_BIT when not yet read
+    unsigned m_front = 2;                   // Owned by the reader
+};
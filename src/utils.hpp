@@ -1,3 +1,4 @@
+#pragma once
 #ifdef _WIN32
 #include <Windows.h>
 #include "direct.h"
@@ -7,6 +8,7 @@
 #include "unistd.h"
 #endif
 #include <map>
+#include <vector>
 #include <sstream>
 #include <iomanip>
 #include <string.h>
@@ -39,6 +41,47 @@ typedef struct FrameInfo_S {
     double fps;
 } FrameInfo_S;
 
+// Stream order shared by Service and the GUI (color, depth, ir)
+typedef enum {
+	STREAM_COLOR = 0,
+	STREAM_DEPTH = 1,
+	STREAM_IR = 2,
+	STREAM_COUNT = 3,
+} StreamIndex;
+
+// A published video frame; holder keeps the memory behind data alive
+typedef struct FrameSlot_S {
+    std::shared_ptr<void> holder;
+    const uint8_t* data = nullptr;
+    uint32_t dataSize = 0;
+    int width = 0, height = 0;
+    OBFrameType type = OB_FRAME_UNKNOWN;
+    OBFormat format = OB_FORMAT_UNKNOWN;
+    uint8_t pixelBitSize = 8;
+    float valueScale = 1.0f;
+    uint64_t index = 0;
+    uint64_t timeStampUs = 0;           // device timestamp
+    uint64_t systemTimeStampUs = 0;     // host timestamp
+    uint64_t publishTimeUs = 0;         // steady clock when Sensors published it, see StreamStats::nowUs()
+} FrameSlot_S;
+
+// A point cloud produced by Sensors; holder keeps the memory behind points alive
+typedef struct PointCloudSlot_S {
+    std::shared_ptr<void> holder;           // filter output frame, when its points are used as they are
+    std::vector<OBColorPoint> buffer;       // reused for clouds converted from OB_FORMAT_POINT
+    const OBColorPoint* points = nullptr;
+    size_t count = 0;
+    uint64_t index = 0;                     // of the depth frame
+} PointCloudSlot_S;
+
+// Running frame counters of one stream
+typedef struct StreamCounters_S {
+    uint64_t received = 0;              // distinct frames published by Sensors
+    uint64_t receivedBytes = 0;
+    uint64_t deviceDropped = 0;         // gaps in the frame index, lost before reaching the application
+    uint64_t converted = 0;             // frames converted for display, the rest were superseded on the host
+} StreamCounters_S;
+
 typedef struct Point3D_S {
     float x, y, z;
 } Point3D_S;
@@ -53,6 +96,11 @@ typedef enum {
 	INIT_RESULT_DEVICE_SELECT_ERROR = -6,
 } ServiceErrorCode;
 
+typedef enum {
+	ACQUISITION_POLLING = 0,		// Acquisition thread calls waitForFrames
+	ACQUISITION_CALLBACK = 1,		// Pipeline frameset callback feeds the frame ring
+} AcquisitionMode;
+
 
 inline float OBDepthPrecisionLevelToFloat(OBDepthPrecisionLevel level) {
 	switch (level) {
@@ -115,7 +163,8 @@ inline std::string OBSensorTypeToString(OBSensorType type) {
 
 inline OBFormat stringToOBFormat(std::string str_fmt) {
 	static std::map<std::string, OBFormat> ob_format_map = { { "YUYV", OB_FORMAT_YUYV }, { "UYVY", OB_FORMAT_UYVY }, { "NV12", OB_FORMAT_NV12 }, { "NV21", OB_FORMAT_NV21 }, { "MJPG", OB_FORMAT_MJPG },
-															 { "H264", OB_FORMAT_H264 }, { "H265", OB_FORMAT_HEVC }, { "I420", OB_FORMAT_I420 }, { "Y16", OB_FORMAT_Y16 },   { "RLE", OB_FORMAT_RLE } };
+															 { "H264", OB_FORMAT_H264 }, { "H265", OB_FORMAT_HEVC }, { "I420", OB_FORMAT_I420 }, { "Y16", OB_FORMAT_Y16 },   { "RLE", OB_FORMAT_RLE },
+															 { "Y8", OB_FORMAT_Y8 },     { "RGB888", OB_FORMAT_RGB888 }, { "BGR", OB_FORMAT_BGR }, { "YUY2", OB_FORMAT_YUY2 } };
 	auto itor = ob_format_map.find(str_fmt);
 	if (itor != ob_format_map.end()) {
 		return itor->second;
@@ -148,6 +197,12 @@ inline std::string OBFormatToString(OBFormat fmt) {
 		return "Y16";
 	case OB_FORMAT_Y8:
 		return "Y8";
+	case OB_FORMAT_YUY2:
+		return "YUY2";
+	case OB_FORMAT_RGB888:
+		return "RGB888";
+	case OB_FORMAT_BGR:
+		return "BGR";
 	default:
 		return "ERROR_TYPE";
 	}